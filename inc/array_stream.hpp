@@ -0,0 +1,57 @@
+#if !defined(JSONPARSER_ARRAYSTREAM_HPP)
+#define JSONPARSER_ARRAYSTREAM_HPP
+
+#include <istream>
+#include <string>
+
+#include "ast.hpp"
+#include "parser.hpp"
+
+namespace json_parser {
+
+// Iterates over the elements of a document whose root is an array, parsing
+// one element at a time. Only the current element is held in memory, so
+// memory use depends on the largest element rather than the input size.
+// Comments between elements are skipped.
+class ArrayStream {
+private:
+    // chunked input, or nullptr when reading a single buffer
+    std::istream *m_in;
+    size_t m_chunk_size;
+    std::string m_chunk;
+
+    // the buffer being scanned
+    const char *m_data;
+    size_t m_len;
+    size_t m_pos;
+    size_t m_offset;
+
+    // start of the current element in m_data, or npos between elements.
+    // Bytes of an element that spans chunks are gathered in m_element
+    size_t m_start;
+    std::string m_element;
+
+    bool m_started, m_done;
+    Parser m_parser;
+    Object *m_current;
+
+    bool fill();
+    bool peek(char &chr);
+    void skip_comment();
+    void scan_element();
+    void error(const std::string &msg);
+
+public:
+    // data is not copied and must outlive the stream, e.g. a mapped file
+    ArrayStream(const char *data, size_t len);
+    ArrayStream(std::istream &in, size_t chunk_size = 1 << 16);
+    ~ArrayStream();
+
+    // the next element, or nullptr after the last one. The element is owned
+    // by the stream and freed by the next call
+    Object *next();
+};
+
+}
+
+#endif // JSONPARSER_ARRAYSTREAM_HPP
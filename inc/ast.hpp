@@ -1,6 +1,7 @@
 #if !defined(JSONPARSER_AST_HPP)
 #define JSONPARSER_AST_HPP
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -19,11 +20,45 @@ enum class JsonTypes {
     JsonBlockComment
 };
 
+// how a JsonArray holds its elements
+enum class ArrayStorage {
+    // one node per element in m_children
+    Boxed,
+    // unboxed values, for arrays of only numbers or only bools
+    Numbers,
+    Bools
+};
+
 std::string obj_type_to_string(JsonTypes type);
+// heap bytes owned by str, 0 when it fits in the small string buffer
+size_t string_heap_bytes(const std::string &str);
+
+// Bytes owned by a subtree, excluding allocator overhead.
+struct MemoryUsage {
+    // the node objects themselves
+    size_t m_nodes = 0;
+    // heap storage of string values and keys
+    size_t m_strings = 0;
+    // capacity of child, key and value vectors
+    size_t m_containers = 0;
+    // comment nodes, their text and the vectors holding them
+    size_t m_comments = 0;
+
+    size_t total() const;
+    MemoryUsage &operator+=(const MemoryUsage &other);
+};
 
 class Object {
 public:
-    size_t m_pos;
+    // the node's text in the input is [m_pos, m_end), m_end is npos for
+    // nodes that were not parsed
+    size_t m_pos, m_end;
+    // changed since parsing: scalars have a new value, containers have
+    // gained or lost members. Set by the mutators
+    bool m_dirty;
+    // the container holding this node as a key, value or element, nullptr
+    // for roots and detached nodes. Kept by the container mutators
+    Object *m_parent;
     std::vector<Object*> m_comment_before;
     std::vector<Object*> m_comment_after;
 
@@ -31,21 +66,74 @@ public:
     virtual ~Object(){}
 
     void add_comment(Object *comment, bool before);
+    // makes a node that was not parsed a changed value standing where old
+    // was in the input
+    void take_place_of(Object *old);
 
     std::string to_string_comments(const std::string &indent);
 
+    MemoryUsage memory_usage();
+
+    // hash of the value, ignoring comments and positions, cached until the
+    // node or anything below it is changed. With unordered, objects holding
+    // the same members in any order hash the same
+    uint64_t hash(bool unordered = false);
+    // drops the cache of this node and the containers above it, done by
+    // every mutator. Only needed after writing m_val directly
+    void clear_hash();
+    // as clear_hash, for every node of the subtree too
+    void clear_hashes();
+
     virtual std::string to_string(const std::string &indent) = 0;
     virtual JsonTypes get_type() = 0;
+    // adds the bytes owned by this node, its children and comments to usage
+    virtual void add_memory_usage(MemoryUsage &usage) = 0;
+
+protected:
+    void add_comments_memory_usage(MemoryUsage &usage);
+    virtual uint64_t compute_hash(bool unordered) = 0;
+
+private:
+    // ordered and unordered hash, valid when the matching bit is set
+    uint64_t m_hash[2];
+    uint8_t m_hashed;
 };
 
 class JsonString : public virtual Object {
-public:
+private:
+    // text between the quotes in the parsed input, not owned. nullptr for
+    // strings built in code or modified after parsing
+    const char *m_raw;
+    size_t m_raw_len;
+    bool m_escaped;
+
+    // decoded value, filled on first access for raw strings
+    bool m_decoded;
     std::string m_val;
 
+public:
     JsonString(size_t pos, const std::string &val);
+    // escaped tells whether raw contains escape sequences
+    JsonString(size_t pos, const char *raw, size_t raw_len, bool escaped);
+
+    const std::string &get_value();
+    void set_value(const std::string &val);
+
+    // compares decoded values, without decoding when there are no escapes
+    bool equals(const char *str, size_t len);
+    bool equals(const std::string &str);
+    bool equals(JsonString *other);
+
+    // bytes between the quotes, as in the input for parsed strings and
+    // before escaping otherwise
+    size_t text_length();
 
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 class JsonNumber : public virtual Object {
@@ -54,8 +142,14 @@ public:
 
     JsonNumber(size_t pos, double val);
 
+    void set_value(double val);
+
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 class JsonBool : public virtual Object {
@@ -64,8 +158,14 @@ public:
 
     JsonBool(size_t pos, bool val);
 
+    void set_value(bool val);
+
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 class JsonNull : public virtual Object {
@@ -74,6 +174,10 @@ public:
 
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 class JsonLineComment : public virtual Object {
@@ -84,6 +188,10 @@ public:
 
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 class JsonBlockComment : public virtual Object {
@@ -94,30 +202,77 @@ public:
 
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 class JsonArray : public virtual Object {
 private:
+    friend class Object;
+    friend class JsonNumber;
+    friend class JsonBool;
+
     std::vector<Object*> m_children;
 
+    ArrayStorage m_storage;
+    std::vector<double> m_numbers;
+    std::vector<uint8_t> m_bools;
+    // nodes handed out by operator[] for packed elements, by index
+    std::vector<std::pair<size_t, Object*>> m_mirrors;
+
+    // copies a mirror's new value into the packed values
+    void write_back(Object *mirror);
+    void box();
+    std::string element_to_string(size_t idx, const std::string &indent);
+
 public:
     JsonArray(size_t pos);
     ~JsonArray();
 
     void add_child(Object *child);
+    // idx may be size() to append. remove_child hands the element back to
+    // the caller instead of deleting it
+    void insert_child(size_t idx, Object *child);
+    Object *remove_child(size_t idx);
+    Object *replace_child(size_t idx, Object *child);
+    // append unboxed while the array holds only values of the same type
+    void add_number(double val);
+    void add_bool(bool val);
 
     size_t size();
 
+    // elements of a packed array are read through a node made for that
+    // index on first access and kept, the packed values stay as they are.
+    // set_value on the node writes through to the array
     Object *operator[](size_t idx);
+    // element values without making nodes, for either storage. 0 and false
+    // when the element has another type
+    double number_at(size_t idx);
+    bool bool_at(size_t idx);
+
+    ArrayStorage get_storage();
+    // the packed values, empty unless get_storage() matches
+    const std::vector<double> &numbers();
+    const std::vector<uint8_t> &bools();
+
+    // appends the lines of elements [begin, end) as to_string writes them,
+    // indent being that of the array itself
+    void append_elements(std::string &result, size_t begin, size_t end, const std::string &indent);
 
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 class JsonObj : public virtual Object {
 private:
-    std::vector<std::string> m_keys;
-    std::vector<Object*> m_keys_obj, m_values_obj;
+    std::vector<JsonString*> m_keys_obj;
+    std::vector<Object*> m_values_obj;
 
 public:
     JsonObj(size_t pos);
@@ -125,11 +280,28 @@ public:
 
     Object *operator[](const std::string &key);
 
+    // nullptr if there is no such key
     Object *get(const std::string &key);
+    size_t size();
+    // for an existing key the original key node is kept and key is freed
     void set(JsonString *key, Object *val);
+    // the value is handed back to the caller, nullptr if there is no such key
+    Object *remove(const std::string &key);
+
+    // members in input order
+    JsonString *key_at(size_t idx);
+    Object *value_at(size_t idx);
+
+    // appends the lines of members [begin, end) as to_string writes them,
+    // indent being that of the object itself
+    void append_elements(std::string &result, size_t begin, size_t end, const std::string &indent);
 
     virtual JsonTypes get_type();
     virtual std::string to_string(const std::string &indent);
+    virtual void add_memory_usage(MemoryUsage &usage);
+
+protected:
+    virtual uint64_t compute_hash(bool unordered);
 };
 
 }
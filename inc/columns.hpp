@@ -0,0 +1,77 @@
+#if !defined(JSONPARSER_COLUMNS_HPP)
+#define JSONPARSER_COLUMNS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+#include "lexer.hpp"
+#include "scan.hpp"
+
+namespace json_parser {
+
+// The values of one field across an array of records.
+struct Column {
+    // dotted path of the field within each record, e.g. "user.id"
+    std::string m_path;
+    // type of the first non-null value, JsonNull while there has been none
+    JsonTypes m_type;
+
+    // one entry per row in the vector matching m_type, with a default value
+    // for rows where the field is null or missing
+    std::vector<double> m_numbers;
+    std::vector<uint8_t> m_bools;
+    std::vector<std::string> m_strings;
+
+    // bit i is set when row i has a value
+    std::vector<uint64_t> m_valid;
+
+    bool is_null(size_t row) const;
+};
+
+// Pulls a fixed set of fields out of every element of an array of objects
+// into typed columns. Working from text, records are scanned token by token
+// and no nodes are built; fields that are not requested are skipped.
+class ColumnExtractor {
+private:
+    // the requested paths within a record, a node's value is its index
+    // into m_columns
+    PathTrie m_trie;
+    std::vector<Column> m_columns;
+    size_t m_rows;
+
+    Lexer m_lexer;
+    Token m_token;
+    std::vector<size_t> m_stack;
+    ValueSkipper m_skipper;
+
+    void end_row();
+    void set_number(size_t column, double val);
+    void set_bool(size_t column, bool val);
+    void set_string(size_t column, const std::string &val);
+    Column &typed_column(size_t column, JsonTypes type);
+
+    Token *next_token();
+    void expect(TokenTypes type);
+    void skip_value();
+    void scan_record();
+    void visit(Object *obj, size_t node);
+
+public:
+    ColumnExtractor(const std::vector<std::string> &paths);
+
+    // rows from text whose root is an array of objects. In both forms an
+    // element that is not an object is a row of nulls
+    void extract(const char *data, size_t len);
+    void extract(const std::string &data);
+    // rows from the elements of an already parsed array
+    void extract(JsonArray *array);
+
+    size_t rows();
+    std::vector<Column> &columns();
+};
+
+}
+
+#endif // JSONPARSER_COLUMNS_HPP
@@ -0,0 +1,71 @@
+#if !defined(JSONPARSER_FORMATTER_HPP)
+#define JSONPARSER_FORMATTER_HPP
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "lexer.hpp"
+
+namespace json_parser {
+
+struct FormatOptions {
+    // drop all whitespace, otherwise pretty print
+    bool m_minify = false;
+    // spaces per level when pretty printing
+    size_t m_indent = 4;
+    bool m_keep_comments = true;
+    // write non-ascii characters in strings as \u escapes
+    bool m_escape_unicode = false;
+};
+
+// Reformats a document token by token, straight from the lexer to the
+// output, without building a tree. Strings and numbers are copied from the
+// input as written. Memory use is independent of the input size, so large
+// inputs can be formatted from a memory mapped file.
+class Formatter {
+private:
+    FormatOptions m_options;
+    Lexer m_lexer;
+    Token m_token;
+    const char *m_data;
+    // decoded string, re-escaped when m_escape_unicode is set
+    std::string m_scratch;
+
+    // output is buffered and flushed to m_stream in blocks
+    std::string m_out;
+    std::ostream *m_stream;
+
+    // closing token expected for each open container, innermost last
+    std::vector<TokenTypes> m_closers;
+    // a container was just opened and is still empty
+    bool m_open;
+    // a line break is due before the next value
+    bool m_break;
+    // a line comment was written, a line break is due before anything
+    bool m_force;
+    // after a colon or a block comment mid line, space out the next value
+    bool m_space;
+    // anything has been written yet
+    bool m_started;
+
+    void write(const char *data, size_t len);
+    void write(char chr);
+    void flush();
+
+    void line_break();
+    void begin_value();
+    void write_string();
+    void write_token();
+
+public:
+    Formatter(const FormatOptions &options = FormatOptions());
+
+    void format(const char *data, size_t len, std::ostream &out);
+    void format(const std::string &data, std::ostream &out);
+    std::string format(const std::string &data);
+};
+
+}
+
+#endif // JSONPARSER_FORMATTER_HPP
@@ -0,0 +1,103 @@
+#if !defined(JSONPARSER_FROZEN_HPP)
+#define JSONPARSER_FROZEN_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ast.hpp"
+
+namespace json_parser {
+
+class FrozenDoc;
+
+// A read only view of one value in a FrozenDoc. Values are small handles
+// that stay valid for as long as the document does.
+class FrozenValue {
+private:
+    const FrozenDoc *m_doc;
+    // index into the document's nodes, npos for a missing value
+    size_t m_idx;
+
+public:
+    FrozenValue(const FrozenDoc *doc, size_t idx);
+
+    // false for the result of looking up a missing key or index
+    bool exists() const;
+    JsonTypes get_type() const;
+    bool is_null() const;
+
+    const std::string &get_string() const;
+    double get_number() const;
+    bool get_bool() const;
+
+    // number of elements or members, 0 for other values
+    size_t size() const;
+    // members are found by binary search on the key
+    FrozenValue get(const std::string &key) const;
+    FrozenValue operator[](const std::string &key) const;
+    FrozenValue operator[](size_t idx) const;
+    // members in input order
+    const std::string &key_at(size_t idx) const;
+    FrozenValue value_at(size_t idx) const;
+
+    std::string to_string(const std::string &indent) const;
+};
+
+// An immutable copy of a tree, made by freeze. Nothing in it changes after
+// construction, so any number of threads can read it without locking.
+// Comments are not kept.
+class FrozenDoc {
+private:
+    friend class FrozenValue;
+
+    struct Node {
+        JsonTypes m_type;
+        // strings: index into m_strings. containers: first slot in m_children
+        size_t m_offset;
+        // containers: element count. bools: the value
+        size_t m_size;
+        double m_number;
+    };
+    std::vector<Node> m_nodes;
+    // the element or member values of each container, contiguous
+    std::vector<size_t> m_children;
+    // parallel to m_children, the key of each member as an index into
+    // m_strings, and for each object its members ordered by key
+    std::vector<size_t> m_keys;
+    std::vector<size_t> m_sorted;
+    std::vector<std::string> m_strings;
+
+    size_t add(Object *obj);
+    size_t add_string(const std::string &str);
+
+public:
+    FrozenDoc(Object *root);
+
+    FrozenValue get_root() const;
+    std::string to_string() const;
+};
+
+// copies a tree into a FrozenDoc, decoding every string up front
+std::shared_ptr<const FrozenDoc> freeze(Object *root);
+
+// The current version of a shared document. Readers take a reference with
+// load and keep using it while a writer publishes a replacement, which is a
+// single exchange of the held pointer; the old version is freed once its
+// last reader lets go.
+class DocSnapshot {
+private:
+    std::shared_ptr<const FrozenDoc> m_doc;
+
+public:
+    DocSnapshot(std::shared_ptr<const FrozenDoc> doc = nullptr);
+
+    std::shared_ptr<const FrozenDoc> load() const;
+    void store(std::shared_ptr<const FrozenDoc> doc);
+    // returns the version that was replaced
+    std::shared_ptr<const FrozenDoc> exchange(std::shared_ptr<const FrozenDoc> doc);
+};
+
+}
+
+#endif // JSONPARSER_FROZEN_HPP
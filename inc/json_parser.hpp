@@ -2,19 +2,39 @@
 #define JSONPARSER_HPP
 
 #include "ast.hpp"
+#include "frozen.hpp"
 #include "parser.hpp"
+#include "preserve.hpp"
+#include "stats.hpp"
 
 namespace json_parser {
 
 class JsonDoc {
 private:
+    // the parsed text, which string nodes point into
+    std::string m_source;
     JsonObj *root = nullptr;
+    ParseStats *m_stats = nullptr;
 
 public:
-    JsonDoc(const std::string &data);
+    // stats, if given, is filled in while parsing and serializing and must
+    // outlive the document
+    JsonDoc(const std::string &data, ParseStats *stats = nullptr);
+    // builds only the given dotted paths, see Parser::set_projection
+    JsonDoc(const std::string &data, const std::vector<std::string> &paths, ParseStats *stats = nullptr);
+    // parses with a caller owned parser so its buffers are reused
+    JsonDoc(Parser &parser, const std::string &data, ParseStats *stats = nullptr);
     ~JsonDoc();
 
+    JsonObj *get_root();
+
     std::string to_string();
+    // the input with only the edited parts rewritten, see write_preserved
+    std::string to_string_preserved();
+    // an immutable copy that can be shared between threads
+    std::shared_ptr<const FrozenDoc> freeze();
+    // bytes held by the document, including the JsonDoc itself
+    MemoryUsage memory_usage();
 };
 
 }
@@ -0,0 +1,56 @@
+#if !defined(JSONPARSER_PARALLELWRITER_HPP)
+#define JSONPARSER_PARALLELWRITER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ast.hpp"
+
+namespace json_parser {
+
+// Serializes a tree on several threads, with output identical to
+// to_string_comments(""). Containers whose estimated output exceeds the
+// split size have their members cut into runs of about that size, which are
+// written to separate buffers concurrently and then joined in order.
+// The tree must not be modified while it is being written.
+class ParallelWriter {
+private:
+    // a piece of the output, either fixed text between runs or a run of
+    // members [m_begin, m_end) of m_node. A whole small node is a run with
+    // m_end == npos
+    struct Segment {
+        std::string m_text;
+        Object *m_node;
+        size_t m_begin, m_end;
+        std::string m_indent;
+    };
+    std::vector<Segment> m_segments;
+
+    size_t m_threads;
+    size_t m_split_size;
+
+    // estimates of nodes above the split size, which are visited again
+    std::unordered_map<Object*, size_t> m_estimates;
+    size_t estimate(Object *obj, size_t depth);
+
+    std::string &text();
+    void add_run(Object *node, size_t begin, size_t end, const std::string &indent);
+    void split(Object *obj, const std::string &indent);
+    void split_members(Object *obj, const std::string &indent);
+    void run_segments();
+    void prepare(Object *root);
+
+public:
+    // threads defaults to the number of cores
+    ParallelWriter(size_t threads = 0, size_t split_size = 1 << 20);
+
+    std::string write(Object *root);
+    // writes straight to a file descriptor with writev, without joining
+    // the pieces first
+    void write(Object *root, int fd);
+};
+
+}
+
+#endif // JSONPARSER_PARALLELWRITER_HPP
@@ -0,0 +1,28 @@
+#if !defined(JSONPARSER_PATCH_HPP)
+#define JSONPARSER_PATCH_HPP
+
+#include "ast.hpp"
+
+namespace json_parser {
+
+// deep copy of a value, without comments. Strings are copied decoded, so the
+// copy does not point into any input
+Object *clone(Object *obj);
+
+// whether two values are equal. Values with different hashes are rejected
+// without being walked, and the hashes are cached for later calls
+bool equal(Object *a, Object *b, bool unordered = false);
+
+// an RFC 6902 patch turning from into to, as an array of operation objects.
+// Key order is ignored and subtrees that are equal are skipped by hash. The
+// patch is a new tree owned by the caller
+JsonArray *diff(Object *from, Object *to);
+
+// applies an RFC 6902 patch to root in place. root is replaced when an
+// operation targets the whole document. A failing operation throws and
+// leaves the operations before it applied
+void apply_patch(Object *&root, JsonArray *patch);
+
+}
+
+#endif // JSONPARSER_PATCH_HPP
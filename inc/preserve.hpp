@@ -0,0 +1,20 @@
+#if !defined(JSONPARSER_PRESERVE_HPP)
+#define JSONPARSER_PRESERVE_HPP
+
+#include <string>
+
+#include "ast.hpp"
+
+namespace json_parser {
+
+// Writes a tree parsed from source back out, copying the input verbatim
+// wherever nothing was changed. Only dirty nodes and nodes without a place
+// in the input are rendered, so whitespace, comments and the spelling of
+// numbers survive everywhere else. Containers that gained or lost members
+// keep the text of the members that remain, new members are laid out like
+// their siblings. Without edits the output is the input.
+std::string write_preserved(Object *root, const std::string &source);
+
+}
+
+#endif // JSONPARSER_PRESERVE_HPP
@@ -0,0 +1,64 @@
+#if !defined(JSONPARSER_STATS_HPP)
+#define JSONPARSER_STATS_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "ast.hpp"
+#include "parser.hpp"
+
+namespace json_parser {
+
+// Optional instrumentation filled in by Parser and JsonDoc. Passing nullptr
+// (the default) disables every measurement, leaving only a pointer check.
+struct ParseStats {
+    // time spent in each phase, in nanoseconds. m_parse_ns excludes the
+    // time spent attaching comments, which is reported in m_comments_ns
+    uint64_t m_lex_ns = 0;
+    uint64_t m_parse_ns = 0;
+    uint64_t m_comments_ns = 0;
+    uint64_t m_serialize_ns = 0;
+
+    // indexed by TokenTypes / JsonTypes
+    size_t m_token_counts[(size_t)TokenTypes::BadToken + 1] = {};
+    size_t m_node_counts[(size_t)JsonTypes::JsonBlockComment + 1] = {};
+
+    // growth of the parser's retained buffers (input copy, tokens and token
+    // vectors) plus nodes and their strings. Container child vectors are
+    // not included
+    size_t m_bytes_allocated = 0;
+    size_t m_max_depth = 0;
+    // largest number of members in a single object or array
+    size_t m_max_width = 0;
+
+    void reset();
+
+    size_t token_count(TokenTypes type) const;
+    size_t node_count(JsonTypes type) const;
+
+    std::string to_string() const;
+};
+
+// Adds the lifetime of the timer to *target, does nothing if target is null.
+class StatsTimer {
+private:
+    uint64_t *m_target;
+    std::chrono::steady_clock::time_point m_start;
+
+public:
+    StatsTimer(uint64_t *target)
+        : m_target(target) {
+        if (m_target)
+            m_start = std::chrono::steady_clock::now();
+    }
+    ~StatsTimer() {
+        if (m_target)
+            *m_target += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - m_start).count();
+    }
+};
+
+}
+
+#endif // JSONPARSER_STATS_HPP
@@ -0,0 +1,182 @@
+#include "array_stream.hpp"
+
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+    const size_t npos = (size_t)-1;
+}
+
+/* ArrayStream */
+json_parser::ArrayStream::ArrayStream(const char *data, size_t len)
+    : m_in(nullptr), m_chunk_size(0),
+      m_data(data), m_len(len), m_pos(0), m_offset(0),
+      m_start(npos), m_started(false), m_done(false), m_current(nullptr) {}
+json_parser::ArrayStream::ArrayStream(std::istream &in, size_t chunk_size)
+    : m_in(&in), m_chunk_size(chunk_size),
+      m_data(nullptr), m_len(0), m_pos(0), m_offset(0),
+      m_start(npos), m_started(false), m_done(false), m_current(nullptr) {}
+json_parser::ArrayStream::~ArrayStream() {
+    delete m_current;
+}
+
+void json_parser::ArrayStream::error(const std::string &msg) {
+    throw std::runtime_error(
+        "Fatal error at: offset " +
+            std::to_string(m_offset + m_pos) +
+        ":\n" + msg
+    );
+}
+
+bool json_parser::ArrayStream::fill() {
+    if (!m_in)
+        return false;
+
+    // keep the part of the current element read so far
+    if (m_start != npos) {
+        m_element.append(m_data + m_start, m_len - m_start);
+        m_start = 0;
+    }
+
+    m_offset += m_len;
+    m_chunk.resize(m_chunk_size);
+    m_in->read(&m_chunk[0], m_chunk_size);
+    m_chunk.resize(m_in->gcount());
+
+    m_data = m_chunk.data();
+    m_len = m_chunk.size();
+    m_pos = 0;
+    return m_len > 0;
+}
+bool json_parser::ArrayStream::peek(char &chr) {
+    if (m_pos == m_len && !fill())
+        return false;
+    chr = m_data[m_pos];
+    return true;
+}
+
+void json_parser::ArrayStream::skip_comment() {
+    char chr;
+    m_pos++;
+    if (!peek(chr) || (chr != '/' && chr != '*'))
+        error("Bad Token: /");
+    m_pos++;
+
+    if (chr == '/') {
+        while (peek(chr) && chr != '\n' && chr != '\r')
+            m_pos++;
+        return;
+    }
+
+    bool star = false;
+    while (1) {
+        if (!peek(chr))
+            error("No closing */ for block comment");
+        m_pos++;
+        if (star && chr == '/')
+            break;
+        star = chr == '*';
+    }
+}
+
+void json_parser::ArrayStream::scan_element() {
+    // finds the end of the element without tokenizing it, so the parser only
+    // sees one element at a time
+    m_start = m_pos;
+    size_t depth = 0;
+    char chr;
+
+    while (peek(chr)) {
+        if (chr == '"') {
+            // strings may hold brackets and commas
+            bool escape = false;
+            m_pos++;
+            while (1) {
+                if (!peek(chr))
+                    error("No closing quote for string");
+                m_pos++;
+                if (escape)
+                    escape = false;
+                else if (chr == '\\')
+                    escape = true;
+                else if (chr == '"')
+                    break;
+            }
+            if (!depth)
+                return;
+            continue;
+        }
+        if (chr == '/') {
+            skip_comment();
+            continue;
+        }
+
+        if (chr == '{' || chr == '[') {
+            depth++;
+        } else if (chr == '}' || chr == ']') {
+            // the end of the root array after a scalar
+            if (!depth)
+                return;
+            if (!--depth) {
+                m_pos++;
+                return;
+            }
+        } else if (!depth && (chr == ',' || isspace((unsigned char)chr))) {
+            return;
+        }
+        m_pos++;
+    }
+
+    if (depth)
+        error("Unexpected end of input");
+}
+
+json_parser::Object *json_parser::ArrayStream::next() {
+    // the previous element may reference m_element, so it goes first
+    delete m_current;
+    m_current = nullptr;
+    m_element.clear();
+
+    if (m_done)
+        return nullptr;
+
+    // skip to the opening bracket, then to the next element
+    char chr;
+    while (1) {
+        if (!peek(chr))
+            error(m_started ? "Unexpected end of input" : "Expected token: Open Bracket");
+
+        if (isspace((unsigned char)chr) || (m_started && chr == ',')) {
+            m_pos++;
+        } else if (chr == '/') {
+            skip_comment();
+        } else if (!m_started) {
+            if (chr != '[')
+                error("Expected token: Open Bracket");
+            m_started = true;
+            m_pos++;
+        } else if (chr == ']') {
+            m_pos++;
+            m_done = true;
+            return nullptr;
+        } else {
+            break;
+        }
+    }
+
+    scan_element();
+
+    // parse in place unless the element spanned chunks
+    const char *data = m_data + m_start;
+    size_t len = m_pos - m_start;
+    if (!m_element.empty()) {
+        m_element.append(data, len);
+        data = m_element.data();
+        len = m_element.size();
+    }
+    m_start = npos;
+
+    m_parser.reset(data, len);
+    m_current = m_parser.parse_any();
+    return m_current;
+}
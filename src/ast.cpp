@@ -1,6 +1,56 @@
 #include "ast.hpp"
+#include "escape.hpp"
 
 #include <algorithm>
+#include <cstring>
+#include <mutex>
+
+namespace {
+    uint64_t mix(uint64_t x) {
+        // splitmix64 finalizer
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+    uint64_t combine(uint64_t seed, uint64_t val) {
+        return mix(seed ^ (val + 0x9E3779B97F4A7C15ULL + (seed << 6) + (seed >> 2)));
+    }
+    uint64_t hash_type(json_parser::JsonTypes type) {
+        return mix((uint64_t)type + 1);
+    }
+    uint64_t hash_bytes(json_parser::JsonTypes type, const char *data, size_t len) {
+        uint64_t result = combine(hash_type(type), len);
+        size_t i = 0;
+        for (; i + 8 <= len; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            result = combine(result, word);
+        }
+        uint64_t tail = 0;
+        memcpy(&tail, data + i, len - i);
+        return combine(result, tail);
+    }
+
+    // shared by nodes and packed array elements so both hash the same
+    uint64_t hash_number(double val) {
+        // -0 and 0 are equal
+        if (val == 0)
+            val = 0;
+        uint64_t bits;
+        memcpy(&bits, &val, 8);
+        return combine(hash_type(json_parser::JsonTypes::JsonNumber), bits);
+    }
+    uint64_t hash_bool(bool val) {
+        return combine(hash_type(json_parser::JsonTypes::JsonBool), val);
+    }
+
+    // guards the mirror nodes of packed arrays. Concurrent readers may ask
+    // for the same element, one lock for all arrays keeps the nodes small
+    std::mutex mirror_mutex;
+}
 
 /* Utils */
 std::string json_parser::obj_type_to_string(JsonTypes type) {
@@ -12,17 +62,46 @@ std::string json_parser::obj_type_to_string(JsonTypes type) {
     case JsonTypes::JsonNumber: return "JsonNumber";
     case JsonTypes::JsonBool: return "JsonBool";
     case JsonTypes::JsonNull: return "JsonNull";
+    case JsonTypes::JsonLineComment: return "JsonLineComment";
+    case JsonTypes::JsonBlockComment: return "JsonBlockComment";
     default: return "Unknown JsonTypes";
     
     }
 }
+size_t json_parser::string_heap_bytes(const std::string &str) {
+    // strings short enough for the small string buffer live inside the object
+    const char *data = str.data();
+    const char *self = reinterpret_cast<const char*>(&str);
+    if (data >= self && data < self + sizeof(str))
+        return 0;
+    return str.capacity() + 1;
+}
+
+/* MemoryUsage */
+size_t json_parser::MemoryUsage::total() const {
+    return m_nodes + m_strings + m_containers + m_comments;
+}
+json_parser::MemoryUsage &json_parser::MemoryUsage::operator+=(const MemoryUsage &other) {
+    m_nodes += other.m_nodes;
+    m_strings += other.m_strings;
+    m_containers += other.m_containers;
+    m_comments += other.m_comments;
+    return *this;
+}
 
 /* Object */
 json_parser::Object::Object(size_t pos)
-    : m_pos(pos) {}
+    : m_pos(pos), m_end(std::string::npos), m_dirty(false), m_parent(nullptr), m_hashed(0) {}
 void json_parser::Object::add_comment(Object *comment, bool before) {
     (before ? m_comment_before : m_comment_after).push_back(comment);
 }
+void json_parser::Object::take_place_of(Object *old) {
+    if (m_end == std::string::npos) {
+        m_pos = old->m_pos;
+        m_end = old->m_end;
+        m_dirty = true;
+    }
+}
 std::string json_parser::Object::to_string_comments(const std::string &indent) {
     std::string result;
     for (int i = 0; i < m_comment_before.size(); i++) {
@@ -34,42 +113,280 @@ std::string json_parser::Object::to_string_comments(const std::string &indent) {
     }
     return result;
 }
+uint64_t json_parser::Object::hash(bool unordered) {
+    if (!(m_hashed & (1 << unordered))) {
+        m_hash[unordered] = compute_hash(unordered);
+        m_hashed |= 1 << unordered;
+    }
+    return m_hash[unordered];
+}
+void json_parser::Object::clear_hash() {
+    // a cached container hash implies cached children, so the walk up can
+    // stop at the first node without one. Mirrors of packed elements are
+    // not hashed with their array, so the parent is always checked
+    m_hashed = 0;
+    for (Object *node = m_parent; node && node->m_hashed; node = node->m_parent)
+        node->m_hashed = 0;
+}
+void json_parser::Object::clear_hashes() {
+    clear_hash();
+    switch (get_type()) {
+    case JsonTypes::JsonArray: {
+        JsonArray *array = dynamic_cast<JsonArray*>(this);
+        for (Object *child : array->m_children)
+            child->clear_hashes();
+        for (auto &mirror : array->m_mirrors)
+            mirror.second->clear_hash();
+        break;
+    }
+    case JsonTypes::JsonObj: {
+        JsonObj *object = dynamic_cast<JsonObj*>(this);
+        for (size_t i = 0; i < object->size(); i++) {
+            object->key_at(i)->clear_hash();
+            object->value_at(i)->clear_hashes();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+json_parser::MemoryUsage json_parser::Object::memory_usage() {
+    MemoryUsage usage;
+    add_memory_usage(usage);
+    return usage;
+}
+void json_parser::Object::add_comments_memory_usage(MemoryUsage &usage) {
+    MemoryUsage comments;
+    for (Object *comment : m_comment_before)
+        comment->add_memory_usage(comments);
+    for (Object *comment : m_comment_after)
+        comment->add_memory_usage(comments);
+
+    usage.m_comments +=
+        comments.total() +
+        (m_comment_before.capacity() + m_comment_after.capacity()) * sizeof(Object*);
+}
 
 /* JsonArray */
 json_parser::JsonArray::JsonArray(size_t pos)
-    : Object(pos) {}
+    : Object(pos), m_storage(ArrayStorage::Boxed) {}
 json_parser::JsonArray::~JsonArray() {
     for (Object *child : m_children)
         delete child;
+    for (auto &mirror : m_mirrors)
+        delete mirror.second;
+}
+void json_parser::JsonArray::box() {
+    if (m_storage == ArrayStorage::Boxed)
+        return;
+
+    // mirrors handed out by operator[] become the elements, so pointers to
+    // them stay valid. Packed elements have no position of their own, use
+    // the array's
+    size_t count = size();
+    auto mirror = m_mirrors.begin();
+    m_children.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        Object *child;
+        if (mirror != m_mirrors.end() && mirror->first == i) {
+            child = (mirror++)->second;
+        } else {
+            if (m_storage == ArrayStorage::Numbers)
+                child = new JsonNumber(m_pos, m_numbers[i]);
+            else
+                child = new JsonBool(m_pos, m_bools[i]);
+            child->m_parent = this;
+        }
+        m_children.push_back(child);
+    }
+
+    m_storage = ArrayStorage::Boxed;
+    std::vector<double>().swap(m_numbers);
+    std::vector<uint8_t>().swap(m_bools);
+    std::vector<std::pair<size_t, Object*>>().swap(m_mirrors);
+}
+void json_parser::JsonArray::write_back(Object *mirror) {
+    std::lock_guard<std::mutex> lock(mirror_mutex);
+    for (auto &entry : m_mirrors) {
+        if (entry.second != mirror)
+            continue;
+        if (m_storage == ArrayStorage::Numbers)
+            m_numbers[entry.first] = dynamic_cast<JsonNumber*>(mirror)->m_val;
+        else
+            m_bools[entry.first] = dynamic_cast<JsonBool*>(mirror)->m_val;
+        // the array's text no longer matches its values
+        m_dirty = true;
+        return;
+    }
 }
 void json_parser::JsonArray::add_child(Object *child) {
+    box();
+    clear_hash();
+    m_dirty = true;
+    child->m_parent = this;
     m_children.push_back(child);
 }
+void json_parser::JsonArray::insert_child(size_t idx, Object *child) {
+    box();
+    clear_hash();
+    m_dirty = true;
+    child->m_parent = this;
+    m_children.insert(m_children.begin() + idx, child);
+}
+json_parser::Object *json_parser::JsonArray::remove_child(size_t idx) {
+    box();
+    clear_hash();
+    m_dirty = true;
+    Object *child = m_children[idx];
+    child->m_parent = nullptr;
+    m_children.erase(m_children.begin() + idx);
+    return child;
+}
+json_parser::Object *json_parser::JsonArray::replace_child(size_t idx, Object *child) {
+    box();
+    clear_hash();
+    Object *old = m_children[idx];
+    child->take_place_of(old);
+    child->m_parent = this;
+    old->m_parent = nullptr;
+    m_children[idx] = child;
+    return old;
+}
+void json_parser::JsonArray::add_number(double val) {
+    clear_hash();
+    m_dirty = true;
+    if (!size())
+        m_storage = ArrayStorage::Numbers;
+
+    if (m_storage == ArrayStorage::Numbers)
+        m_numbers.push_back(val);
+    else
+        add_child(new JsonNumber(m_pos, val));
+}
+void json_parser::JsonArray::add_bool(bool val) {
+    clear_hash();
+    m_dirty = true;
+    if (!size())
+        m_storage = ArrayStorage::Bools;
+
+    if (m_storage == ArrayStorage::Bools)
+        m_bools.push_back(val);
+    else
+        add_child(new JsonBool(m_pos, val));
+}
 size_t json_parser::JsonArray::size() {
-    return m_children.size();
+    switch (m_storage) {
+    case ArrayStorage::Numbers: return m_numbers.size();
+    case ArrayStorage::Bools: return m_bools.size();
+    default: return m_children.size();
+    }
 }
 json_parser::Object *json_parser::JsonArray::operator[](size_t idx) {
-    return m_children[idx];
+    if (m_storage == ArrayStorage::Boxed)
+        return m_children[idx];
+
+    std::lock_guard<std::mutex> lock(mirror_mutex);
+    auto it = std::lower_bound(m_mirrors.begin(), m_mirrors.end(), idx,
+        [](const std::pair<size_t, Object*> &mirror, size_t val) { return mirror.first < val; });
+    if (it != m_mirrors.end() && it->first == idx)
+        return it->second;
+
+    Object *node;
+    if (m_storage == ArrayStorage::Numbers)
+        node = new JsonNumber(m_pos, m_numbers[idx]);
+    else
+        node = new JsonBool(m_pos, m_bools[idx]);
+    node->m_parent = this;
+    m_mirrors.insert(it, { idx, node });
+    return node;
+}
+double json_parser::JsonArray::number_at(size_t idx) {
+    if (m_storage == ArrayStorage::Numbers)
+        return m_numbers[idx];
+    if (m_storage == ArrayStorage::Bools)
+        return 0;
+    JsonNumber *number = dynamic_cast<JsonNumber*>(m_children[idx]);
+    return number ? number->m_val : 0;
+}
+bool json_parser::JsonArray::bool_at(size_t idx) {
+    if (m_storage == ArrayStorage::Bools)
+        return m_bools[idx];
+    if (m_storage == ArrayStorage::Numbers)
+        return false;
+    JsonBool *val = dynamic_cast<JsonBool*>(m_children[idx]);
+    return val && val->m_val;
+}
+json_parser::ArrayStorage json_parser::JsonArray::get_storage() {
+    return m_storage;
+}
+const std::vector<double> &json_parser::JsonArray::numbers() {
+    return m_numbers;
+}
+const std::vector<uint8_t> &json_parser::JsonArray::bools() {
+    return m_bools;
 }
 json_parser::JsonTypes json_parser::JsonArray::get_type() {
     return JsonTypes::JsonArray;
 }
+std::string json_parser::JsonArray::element_to_string(size_t idx, const std::string &indent) {
+    // matches JsonNumber and JsonBool, packed elements never have comments
+    switch (m_storage) {
+    case ArrayStorage::Numbers: return std::to_string(m_numbers[idx]);
+    case ArrayStorage::Bools: return m_bools[idx] ? "true" : "false";
+    default: return m_children[idx]->to_string_comments(indent);
+    }
+}
 std::string json_parser::JsonArray::to_string(const std::string &indent) {
-    if (!m_children.size())
+    size_t count = size();
+    if (!count)
         return "[]";
     
     std::string result = "[\n";
-
-    for (int i = 0; i < m_children.size(); i++) {
-        result += indent + "    " + m_children[i]->to_string_comments(indent + "    ");
-        if (i + 1 < m_children.size())
+    append_elements(result, 0, count, indent);
+    result += indent + ']';
+    return result;
+}
+void json_parser::JsonArray::append_elements(std::string &result, size_t begin, size_t end, const std::string &indent) {
+    size_t count = size();
+    for (size_t i = begin; i < end; i++) {
+        result += indent + "    " + element_to_string(i, indent + "    ");
+        if (i + 1 < count)
             result += ',';
         result += '\n';
     }
-
-    result += indent + ']';
+}
+uint64_t json_parser::JsonArray::compute_hash(bool unordered) {
+    uint64_t result = combine(hash_type(JsonTypes::JsonArray), size());
+    switch (m_storage) {
+    case ArrayStorage::Numbers:
+        for (double val : m_numbers)
+            result = combine(result, hash_number(val));
+        break;
+    case ArrayStorage::Bools:
+        for (uint8_t val : m_bools)
+            result = combine(result, hash_bool(val));
+        break;
+    default:
+        for (Object *child : m_children)
+            result = combine(result, child->hash(unordered));
+        break;
+    }
     return result;
 }
+void json_parser::JsonArray::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonArray);
+    usage.m_containers +=
+        m_children.capacity() * sizeof(Object*) +
+        m_numbers.capacity() * sizeof(double) +
+        m_bools.capacity() * sizeof(uint8_t);
+    usage.m_containers += m_mirrors.capacity() * sizeof(m_mirrors[0]);
+    add_comments_memory_usage(usage);
+    for (Object *child : m_children)
+        child->add_memory_usage(usage);
+    for (auto &mirror : m_mirrors)
+        mirror.second->add_memory_usage(usage);
+}
 
 /* JsonObj */
 json_parser::JsonObj::JsonObj(size_t pos)
@@ -84,72 +401,232 @@ json_parser::Object *json_parser::JsonObj::operator[](const std::string &key) {
     return get(key);
 }
 json_parser::Object *json_parser::JsonObj::get(const std::string &key) {
-    return m_values_obj[std::distance(m_keys.begin(), std::find(m_keys.begin(), m_keys.end(), key))];
+    for (size_t i = 0; i < m_keys_obj.size(); i++) {
+        if (m_keys_obj[i]->equals(key))
+            return m_values_obj[i];
+    }
+    return nullptr;
+}
+size_t json_parser::JsonObj::size() {
+    return m_keys_obj.size();
 }
 void json_parser::JsonObj::set(JsonString *key, Object *val) {
-    auto pos = std::find(m_keys.begin(), m_keys.end(), key->m_val);
-    if (pos == m_keys.end()) {
-        m_keys.push_back(key->m_val);
-        m_keys_obj.push_back(key);
-        m_values_obj.push_back(val);
-    } else {
-        size_t idx = std::distance(m_keys.begin(), pos);
-        m_keys_obj[idx] = key;
-        m_values_obj[idx] = val;
+    for (size_t i = 0; i < m_keys_obj.size(); i++) {
+        if (m_keys_obj[i]->equals(key)) {
+            clear_hash();
+            m_dirty = true;
+            // a repeated key replaces the earlier value in its place
+            if (key != m_keys_obj[i])
+                delete key;
+            if (val != m_values_obj[i]) {
+                val->take_place_of(m_values_obj[i]);
+                delete m_values_obj[i];
+            }
+            val->m_parent = this;
+            m_values_obj[i] = val;
+            return;
+        }
     }
+    clear_hash();
+    m_dirty = true;
+    key->m_parent = this;
+    val->m_parent = this;
+    m_keys_obj.push_back(key);
+    m_values_obj.push_back(val);
+}
+json_parser::Object *json_parser::JsonObj::remove(const std::string &key) {
+    for (size_t i = 0; i < m_keys_obj.size(); i++) {
+        if (m_keys_obj[i]->equals(key)) {
+            Object *val = m_values_obj[i];
+            val->m_parent = nullptr;
+            m_dirty = true;
+            delete m_keys_obj[i];
+            m_keys_obj.erase(m_keys_obj.begin() + i);
+            m_values_obj.erase(m_values_obj.begin() + i);
+            clear_hash();
+            return val;
+        }
+    }
+    return nullptr;
+}
+json_parser::JsonString *json_parser::JsonObj::key_at(size_t idx) {
+    return m_keys_obj[idx];
+}
+json_parser::Object *json_parser::JsonObj::value_at(size_t idx) {
+    return m_values_obj[idx];
 }
 json_parser::JsonTypes json_parser::JsonObj::get_type() {
     return JsonTypes::JsonObj;
 }
 std::string json_parser::JsonObj::to_string(const std::string &indent) {
-    if (!m_keys.size())
+    if (!m_keys_obj.size())
         return "{}";
 
     std::string result = "{\n";
-
+    append_elements(result, 0, m_keys_obj.size(), indent);
+    result += indent + '}';
+    return result;
+}
+void json_parser::JsonObj::append_elements(std::string &result, size_t begin, size_t end, const std::string &indent) {
     // in order of keys to maintain input order
-    for (size_t i = 0; i < m_keys.size(); i++) {
+    for (size_t i = begin; i < end; i++) {
         result += 
             indent + "    " + m_keys_obj[i]->to_string_comments(indent + "    ") + ": " +
             m_values_obj[i]->to_string_comments(indent + "    ");
-        if (i + 1 < m_keys.size())
+        if (i + 1 < m_keys_obj.size())
             result += ',';
         result += '\n';
     }
+}
+uint64_t json_parser::JsonObj::compute_hash(bool unordered) {
+    uint64_t result = combine(hash_type(JsonTypes::JsonObj), m_keys_obj.size());
+    if (!unordered) {
+        for (size_t i = 0; i < m_keys_obj.size(); i++) {
+            result = combine(result, m_keys_obj[i]->hash());
+            result = combine(result, m_values_obj[i]->hash());
+        }
+        return result;
+    }
 
-    result += indent + '}';
-    return result;
+    // keys are unique, so a sum of the member hashes ignores their order
+    uint64_t members = 0;
+    for (size_t i = 0; i < m_keys_obj.size(); i++)
+        members += combine(m_keys_obj[i]->hash(), m_values_obj[i]->hash(true));
+    return combine(result, members);
+}
+void json_parser::JsonObj::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonObj);
+    usage.m_containers +=
+        m_keys_obj.capacity() * sizeof(JsonString*) +
+        m_values_obj.capacity() * sizeof(Object*);
+    add_comments_memory_usage(usage);
+    for (size_t i = 0; i < m_keys_obj.size(); i++) {
+        m_keys_obj[i]->add_memory_usage(usage);
+        m_values_obj[i]->add_memory_usage(usage);
+    }
 }
 
 /* JsonString */
 json_parser::JsonString::JsonString(size_t pos, const std::string &val)
-    : Object(pos), m_val(val) {}
+    : Object(pos), m_raw(nullptr), m_raw_len(0), m_escaped(false),
+      m_decoded(true), m_val(val) {}
+json_parser::JsonString::JsonString(size_t pos, const char *raw, size_t raw_len, bool escaped)
+    : Object(pos), m_raw(raw), m_raw_len(raw_len), m_escaped(escaped),
+      m_decoded(false) {}
+const std::string &json_parser::JsonString::get_value() {
+    if (!m_decoded) {
+        unescape_string(m_raw, m_raw_len, m_val);
+        m_decoded = true;
+    }
+    return m_val;
+}
+void json_parser::JsonString::set_value(const std::string &val) {
+    clear_hash();
+    m_dirty = true;
+    m_val = val;
+    m_decoded = true;
+    m_raw = nullptr;
+    m_raw_len = 0;
+    m_escaped = false;
+}
+bool json_parser::JsonString::equals(const char *str, size_t len) {
+    // without escapes the raw text is the value
+    if (m_raw && !m_escaped)
+        return m_raw_len == len && memcmp(m_raw, str, len) == 0;
+    const std::string &val = get_value();
+    return val.length() == len && memcmp(val.data(), str, len) == 0;
+}
+bool json_parser::JsonString::equals(const std::string &str) {
+    return equals(str.data(), str.length());
+}
+bool json_parser::JsonString::equals(JsonString *other) {
+    if (other->m_raw && !other->m_escaped)
+        return equals(other->m_raw, other->m_raw_len);
+    const std::string &val = other->get_value();
+    return equals(val.data(), val.length());
+}
+size_t json_parser::JsonString::text_length() {
+    return m_raw ? m_raw_len : m_val.length();
+}
 json_parser::JsonTypes json_parser::JsonString::get_type() {
     return JsonTypes::JsonString;
 }
 std::string json_parser::JsonString::to_string(const std::string &indent) {
-    return '"' + m_val + '"';
+    // parsed strings are still escaped as in the input
+    if (m_raw)
+        return '"' + std::string(m_raw, m_raw_len) + '"';
+
+    std::string result;
+    result.reserve(m_val.length() + 2);
+    result += '"';
+    escape_string(m_val.data(), m_val.length(), result);
+    result += '"';
+    return result;
+}
+uint64_t json_parser::JsonString::compute_hash(bool unordered) {
+    // without escapes the raw text is the value
+    if (m_raw && !m_escaped)
+        return hash_bytes(JsonTypes::JsonString, m_raw, m_raw_len);
+    const std::string &val = get_value();
+    return hash_bytes(JsonTypes::JsonString, val.data(), val.length());
+}
+void json_parser::JsonString::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonString);
+    usage.m_strings += string_heap_bytes(m_val);
+    add_comments_memory_usage(usage);
 }
 
 /* JsonNumber */
 json_parser::JsonNumber::JsonNumber(size_t pos, double val)
     : Object(pos), m_val(val) {}
+void json_parser::JsonNumber::set_value(double val) {
+    clear_hash();
+    m_dirty = true;
+    m_val = val;
+    if (JsonArray *array = dynamic_cast<JsonArray*>(m_parent)) {
+        if (array->m_storage == ArrayStorage::Numbers)
+            array->write_back(this);
+    }
+}
 json_parser::JsonTypes json_parser::JsonNumber::get_type() {
     return JsonTypes::JsonNumber;
 }
 std::string json_parser::JsonNumber::to_string(const std::string &indent) {
     return std::to_string(m_val);
 }
+uint64_t json_parser::JsonNumber::compute_hash(bool unordered) {
+    return hash_number(m_val);
+}
+void json_parser::JsonNumber::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonNumber);
+    add_comments_memory_usage(usage);
+}
 
 /* JsonBool */
 json_parser::JsonBool::JsonBool(size_t pos, bool val)
     : Object(pos), m_val(val) {}
+void json_parser::JsonBool::set_value(bool val) {
+    clear_hash();
+    m_dirty = true;
+    m_val = val;
+    if (JsonArray *array = dynamic_cast<JsonArray*>(m_parent)) {
+        if (array->m_storage == ArrayStorage::Bools)
+            array->write_back(this);
+    }
+}
 json_parser::JsonTypes json_parser::JsonBool::get_type() {
     return JsonTypes::JsonBool;
 }
 std::string json_parser::JsonBool::to_string(const std::string &indent) {
     return m_val ? "true" : "false";
 }
+uint64_t json_parser::JsonBool::compute_hash(bool unordered) {
+    return hash_bool(m_val);
+}
+void json_parser::JsonBool::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonBool);
+    add_comments_memory_usage(usage);
+}
 
 /* JsonNull */
 json_parser::JsonNull::JsonNull(size_t pos)
@@ -160,6 +637,13 @@ json_parser::JsonTypes json_parser::JsonNull::get_type() {
 std::string json_parser::JsonNull::to_string(const std::string &indent) {
     return "null";
 }
+uint64_t json_parser::JsonNull::compute_hash(bool unordered) {
+    return hash_type(JsonTypes::JsonNull);
+}
+void json_parser::JsonNull::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonNull);
+    add_comments_memory_usage(usage);
+}
 
 /* JsonLineComment */
 json_parser::JsonLineComment::JsonLineComment(size_t pos, const std::string &comment)
@@ -170,6 +654,14 @@ json_parser::JsonTypes json_parser::JsonLineComment::get_type() {
 std::string json_parser::JsonLineComment::to_string(const std::string &indent) {
     return "//" + m_val + '\n';
 }
+uint64_t json_parser::JsonLineComment::compute_hash(bool unordered) {
+    return hash_bytes(JsonTypes::JsonLineComment, m_val.data(), m_val.length());
+}
+void json_parser::JsonLineComment::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonLineComment);
+    usage.m_strings += string_heap_bytes(m_val);
+    add_comments_memory_usage(usage);
+}
 
 /* JsonBlockComment */
 json_parser::JsonBlockComment::JsonBlockComment(size_t pos, const std::string &comment)
@@ -180,3 +672,11 @@ json_parser::JsonTypes json_parser::JsonBlockComment::get_type() {
 std::string json_parser::JsonBlockComment::to_string(const std::string &indent) {
     return "/*" + m_val + "*/\n";
 }
+uint64_t json_parser::JsonBlockComment::compute_hash(bool unordered) {
+    return hash_bytes(JsonTypes::JsonBlockComment, m_val.data(), m_val.length());
+}
+void json_parser::JsonBlockComment::add_memory_usage(MemoryUsage &usage) {
+    usage.m_nodes += sizeof(JsonBlockComment);
+    usage.m_strings += string_heap_bytes(m_val);
+    add_comments_memory_usage(usage);
+}
@@ -0,0 +1,241 @@
+#include "columns.hpp"
+
+#include <stdexcept>
+
+namespace {
+    const size_t npos = (size_t)-1;
+}
+
+/* Column */
+bool json_parser::Column::is_null(size_t row) const {
+    return row / 64 >= m_valid.size() || !((m_valid[row / 64] >> (row % 64)) & 1);
+}
+
+/* ColumnExtractor */
+json_parser::ColumnExtractor::ColumnExtractor(const std::vector<std::string> &paths)
+    : m_rows(0), m_token(TokenTypes::EOFToken, "", 0, 0, 0) {
+    for (const std::string &path : paths) {
+        size_t node = m_trie.add(path);
+        if (m_trie[node].m_value == npos) {
+            m_trie[node].m_value = m_columns.size();
+            m_columns.push_back(Column());
+            m_columns.back().m_path = path;
+            m_columns.back().m_type = JsonTypes::JsonNull;
+        }
+    }
+}
+
+void json_parser::ColumnExtractor::end_row() {
+    // pad the columns that had no value in this row
+    for (Column &col : m_columns) {
+        col.m_valid.resize(m_rows / 64 + 1);
+        switch (col.m_type) {
+        case JsonTypes::JsonNumber:
+            if (col.m_numbers.size() == m_rows)
+                col.m_numbers.push_back(0);
+            break;
+        case JsonTypes::JsonBool:
+            if (col.m_bools.size() == m_rows)
+                col.m_bools.push_back(0);
+            break;
+        case JsonTypes::JsonString:
+            if (col.m_strings.size() == m_rows)
+                col.m_strings.emplace_back();
+            break;
+        default:
+            break;
+        }
+    }
+    m_rows++;
+}
+
+json_parser::Column &json_parser::ColumnExtractor::typed_column(size_t column, JsonTypes type) {
+    Column &col = m_columns[column];
+
+    if (col.m_type == JsonTypes::JsonNull) {
+        // first value, earlier rows were all null
+        col.m_type = type;
+        col.m_numbers.resize(type == JsonTypes::JsonNumber ? m_rows : 0);
+        col.m_bools.resize(type == JsonTypes::JsonBool ? m_rows : 0);
+        col.m_strings.resize(type == JsonTypes::JsonString ? m_rows : 0);
+    } else if (col.m_type != type) {
+        throw std::runtime_error(
+            "Column " + col.m_path + " holds " + obj_type_to_string(col.m_type) +
+            " but row " + std::to_string(m_rows) + " has " + obj_type_to_string(type));
+    }
+
+    col.m_valid.resize(m_rows / 64 + 1);
+    col.m_valid[m_rows / 64] |= (uint64_t)1 << (m_rows % 64);
+    return col;
+}
+void json_parser::ColumnExtractor::set_number(size_t column, double val) {
+    Column &col = typed_column(column, JsonTypes::JsonNumber);
+    // a repeated key overwrites the earlier value, as in JsonObj::set
+    if (col.m_numbers.size() > m_rows)
+        col.m_numbers.back() = val;
+    else
+        col.m_numbers.push_back(val);
+}
+void json_parser::ColumnExtractor::set_bool(size_t column, bool val) {
+    Column &col = typed_column(column, JsonTypes::JsonBool);
+    if (col.m_bools.size() > m_rows)
+        col.m_bools.back() = val;
+    else
+        col.m_bools.push_back(val);
+}
+void json_parser::ColumnExtractor::set_string(size_t column, const std::string &val) {
+    Column &col = typed_column(column, JsonTypes::JsonString);
+    if (col.m_strings.size() > m_rows)
+        col.m_strings.back() = val;
+    else
+        col.m_strings.push_back(val);
+}
+
+json_parser::Token *json_parser::ColumnExtractor::next_token() {
+    TokenTypes type;
+    do {
+        type = m_lexer.next(m_token)->m_type;
+    } while (type == TokenTypes::WhiteSpace ||
+             type == TokenTypes::LineComment ||
+             type == TokenTypes::BlockComment);
+    return &m_token;
+}
+void json_parser::ColumnExtractor::expect(TokenTypes type) {
+    if (m_token.m_type != type) {
+        Lexer::error(
+            "Expected token: " +
+                token_type_to_string(type) +
+            "\nActual token: " +
+                token_type_to_string(m_token.m_type),
+            m_token.m_row,
+            m_token.m_col
+        );
+    }
+}
+void json_parser::ColumnExtractor::skip_value() {
+    m_skipper.reset();
+    bool more;
+    do {
+        more = m_skipper.step(m_token);
+        next_token();
+    } while (more);
+}
+
+void json_parser::ColumnExtractor::scan_record() {
+    // m_stack holds the trie node of each open object, objects that no
+    // path leads into are skipped as a whole
+    m_stack.clear();
+    m_stack.push_back(0);
+    next_token();
+
+    while (!m_stack.empty()) {
+        if (m_token.m_type == TokenTypes::CloseBrace) {
+            m_stack.pop_back();
+            next_token();
+            if (!m_stack.empty() && m_token.m_type == TokenTypes::Comma)
+                next_token();
+            continue;
+        }
+
+        expect(TokenTypes::String);
+        size_t node = m_trie.find(m_stack.back(), m_token.m_value);
+        // the colon is optional, as in Parser
+        if (next_token()->m_type == TokenTypes::Colon)
+            next_token();
+
+        size_t column = node == npos ? npos : m_trie[node].m_value;
+        if (node == npos) {
+            skip_value();
+        } else if (m_token.m_type == TokenTypes::OpenBrace && m_trie[node].m_children.size()) {
+            m_stack.push_back(node);
+            next_token();
+            continue;
+        } else if (column != npos && m_token.m_type == TokenTypes::Number) {
+            set_number(column, std::stod(m_token.m_value));
+            next_token();
+        } else if (column != npos && m_token.m_type == TokenTypes::Bool) {
+            set_bool(column, m_token.m_value == "true");
+            next_token();
+        } else if (column != npos && m_token.m_type == TokenTypes::String) {
+            set_string(column, m_token.m_value);
+            next_token();
+        } else {
+            // null, or an object or array where a field was expected
+            skip_value();
+        }
+
+        if (m_token.m_type == TokenTypes::Comma)
+            next_token();
+    }
+}
+
+void json_parser::ColumnExtractor::extract(const char *data, size_t len) {
+    m_lexer.reset(data, len);
+    next_token();
+    expect(TokenTypes::OpenBracket);
+    next_token();
+
+    while (m_token.m_type != TokenTypes::CloseBracket) {
+        // a record that is not an object is a row of nulls
+        if (m_token.m_type == TokenTypes::OpenBrace)
+            scan_record();
+        else
+            skip_value();
+        end_row();
+
+        if (m_token.m_type == TokenTypes::Comma)
+            next_token();
+    }
+}
+void json_parser::ColumnExtractor::extract(const std::string &data) {
+    extract(data.data(), data.length());
+}
+
+void json_parser::ColumnExtractor::visit(Object *obj, size_t node) {
+    JsonObj *record = dynamic_cast<JsonObj*>(obj);
+    if (!record)
+        return;
+
+    for (const auto &child : m_trie[node].m_children) {
+        Object *val = record->get(child.first);
+        if (!val)
+            continue;
+
+        size_t column = m_trie[child.second].m_value;
+        switch (val->get_type()) {
+        case JsonTypes::JsonObj:
+            visit(val, child.second);
+            break;
+        case JsonTypes::JsonNumber:
+            if (column != npos)
+                set_number(column, dynamic_cast<JsonNumber*>(val)->m_val);
+            break;
+        case JsonTypes::JsonBool:
+            if (column != npos)
+                set_bool(column, dynamic_cast<JsonBool*>(val)->m_val);
+            break;
+        case JsonTypes::JsonString:
+            if (column != npos)
+                set_string(column, dynamic_cast<JsonString*>(val)->get_value());
+            break;
+        default:
+            break;
+        }
+    }
+}
+void json_parser::ColumnExtractor::extract(JsonArray *array) {
+    // packed numbers or bools are all rows of nulls, read without nodes
+    bool boxed = array->get_storage() == ArrayStorage::Boxed;
+    for (size_t i = 0; i < array->size(); i++) {
+        if (boxed)
+            visit((*array)[i], 0);
+        end_row();
+    }
+}
+
+size_t json_parser::ColumnExtractor::rows() {
+    return m_rows;
+}
+std::vector<json_parser::Column> &json_parser::ColumnExtractor::columns() {
+    return m_columns;
+}
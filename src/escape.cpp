@@ -0,0 +1,155 @@
+#include "escape.hpp"
+#include "utf8.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+    uint32_t read_hex4(const char *data) {
+        uint32_t code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = data[i];
+            code = code * 16 + (c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+        }
+        return code;
+    }
+
+    const char HEX_DIGITS[] = "0123456789abcdef";
+
+    void append_hex4(std::string &out, uint32_t code) {
+        char buf[6] = { '\\', 'u',
+            HEX_DIGITS[(code >> 12) & 0xF], HEX_DIGITS[(code >> 8) & 0xF],
+            HEX_DIGITS[(code >> 4) & 0xF], HEX_DIGITS[code & 0xF] };
+        out.append(buf, 6);
+    }
+
+    // code point of a valid UTF-8 sequence of the given length
+    uint32_t decode_utf8(const char *data, size_t len) {
+        const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+        uint32_t code = bytes[0] & (0xFF >> (len + 1));
+        for (size_t i = 1; i < len; i++)
+            code = (code << 6) | (bytes[i] & 0x3F);
+        return code;
+    }
+}
+
+/* Unescaping */
+void json_parser::unescape_string(const char *data, size_t len, std::string &out) {
+    const char *end = data + len;
+
+    while (data < end) {
+        // copy up to the next escape in one go
+        const char *slash = static_cast<const char*>(memchr(data, '\\', end - data));
+        if (!slash) {
+            out.append(data, end - data);
+            return;
+        }
+        out.append(data, slash - data);
+
+        switch (slash[1]) {
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            uint32_t code = read_hex4(slash + 2);
+            if (code >= 0xD800 && code <= 0xDBFF) {
+                code = 0x10000 + ((code - 0xD800) << 10) + (read_hex4(slash + 8) - 0xDC00);
+                data = slash + 12;
+            } else {
+                data = slash + 6;
+            }
+            append_utf8(out, code);
+            continue;
+        }
+        // '"', '\\' and '/' stand for themselves
+        default: out += slash[1]; break;
+        }
+        data = slash + 2;
+    }
+}
+
+/* Escaping */
+size_t json_parser::escape_run_length(const char *data, size_t len, bool ascii_only) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    // signed compare, so bytes >= 0x80 are below the bound as well
+    const __m128i control = _mm_set1_epi8(0x20);
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmplt_epi8(chunk, control));
+
+        // drop the non-ascii bytes caught by the signed compare
+        if (!ascii_only)
+            special = _mm_andnot_si128(_mm_cmplt_epi8(chunk, zero), special);
+
+        if (_mm_movemask_epi8(special))
+            break;
+    }
+#endif
+
+    // tail, or the block containing the first special byte
+    for (; i < len; i++) {
+        unsigned char c = data[i];
+        if (c < 0x20 || c == '"' || c == '\\' || (ascii_only && c >= 0x80))
+            break;
+    }
+    return i;
+}
+
+void json_parser::escape_string(const char *data, size_t len, std::string &out, bool ascii_only) {
+    size_t i = 0;
+    while (i < len) {
+        // bulk copy the clean run, the common case
+        size_t run = escape_run_length(data + i, len - i, ascii_only);
+        out.append(data + i, run);
+        i += run;
+        if (i == len)
+            break;
+
+        unsigned char c = data[i];
+        if (c >= 0x80) {
+            // only reached with ascii_only. Invalid bytes are copied as is
+            size_t length = utf8_sequence_length(data + i, len - i);
+            if (!length) {
+                out += data[i++];
+                continue;
+            }
+
+            uint32_t code = decode_utf8(data + i, length);
+            if (code >= 0x10000) {
+                code -= 0x10000;
+                append_hex4(out, 0xD800 + (code >> 10));
+                append_hex4(out, 0xDC00 + (code & 0x3FF));
+            } else {
+                append_hex4(out, code);
+            }
+            i += length;
+            continue;
+        }
+
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default: append_hex4(out, c); break;
+        }
+        i++;
+    }
+}
@@ -0,0 +1,23 @@
+#if !defined(JSONPARSER_ESCAPE_HPP)
+#define JSONPARSER_ESCAPE_HPP
+
+#include <cstddef>
+#include <string>
+
+namespace json_parser {
+
+// appends the decoded value of the text between the quotes of a string
+// literal. The text must already have been validated by the Lexer
+void unescape_string(const char *data, size_t len, std::string &out);
+
+// number of leading bytes that need no escaping, i.e. stops at '"', '\\',
+// control characters and, if ascii_only, non-ascii
+size_t escape_run_length(const char *data, size_t len, bool ascii_only);
+
+// appends data escaped for use between the quotes of a string literal. With
+// ascii_only, non-ascii characters are written as \u escapes
+void escape_string(const char *data, size_t len, std::string &out, bool ascii_only = false);
+
+}
+
+#endif // JSONPARSER_ESCAPE_HPP
@@ -0,0 +1,174 @@
+#include "formatter.hpp"
+#include "escape.hpp"
+
+#include <sstream>
+
+namespace {
+    // output is handed to the stream in blocks of this size
+    const size_t FLUSH_SIZE = 1 << 16;
+}
+
+/* Formatter */
+json_parser::Formatter::Formatter(const FormatOptions &options)
+    : m_options(options), m_token(TokenTypes::EOFToken, "", 0, 0, 0),
+      m_data(nullptr), m_stream(nullptr),
+      m_open(false), m_break(false), m_force(false), m_space(false), m_started(false) {
+    // strings are copied as written, so only validate them
+    m_lexer.set_decode(false);
+}
+
+void json_parser::Formatter::write(const char *data, size_t len) {
+    m_out.append(data, len);
+    m_started = true;
+    if (m_out.size() >= FLUSH_SIZE)
+        flush();
+}
+void json_parser::Formatter::write(char chr) {
+    write(&chr, 1);
+}
+void json_parser::Formatter::flush() {
+    m_stream->write(m_out.data(), m_out.size());
+    m_out.clear();
+}
+
+void json_parser::Formatter::line_break() {
+    if (!m_options.m_minify) {
+        m_out += '\n';
+        m_out.append(m_closers.size() * m_options.m_indent, ' ');
+    } else if (m_force) {
+        // a line comment must still end its line
+        m_out += '\n';
+    }
+    m_break = m_force = false;
+}
+void json_parser::Formatter::begin_value() {
+    if (m_break || m_force)
+        line_break();
+    else if (m_space && !m_options.m_minify)
+        write(' ');
+    m_open = m_space = false;
+}
+
+void json_parser::Formatter::write_string() {
+    const char *raw = m_data + m_token.m_pos + 1;
+    size_t len = m_token.m_len - 2;
+
+    // already ascii with no escapes to normalise, copy as written
+    if (!m_options.m_escape_unicode || escape_run_length(raw, len, true) == len) {
+        write(m_data + m_token.m_pos, m_token.m_len);
+        return;
+    }
+
+    m_scratch.clear();
+    unescape_string(raw, len, m_scratch);
+    m_out += '"';
+    escape_string(m_scratch.data(), m_scratch.length(), m_out, true);
+    write('"');
+}
+void json_parser::Formatter::write_token() {
+    switch (m_token.m_type) {
+    case TokenTypes::OpenBrace:
+    case TokenTypes::OpenBracket:
+        begin_value();
+        write(m_token.m_value[0]);
+        m_closers.push_back(m_token.m_type == TokenTypes::OpenBrace ?
+            TokenTypes::CloseBrace : TokenTypes::CloseBracket);
+        m_open = m_break = true;
+        break;
+
+    case TokenTypes::CloseBrace:
+    case TokenTypes::CloseBracket:
+        if (m_closers.empty() || m_closers.back() != m_token.m_type) {
+            Lexer::error(
+                "Unexpected token: " + token_type_to_string(m_token.m_type),
+                m_token.m_row, m_token.m_col);
+        }
+        m_closers.pop_back();
+        // empty containers stay on one line
+        if (!m_open || m_force)
+            line_break();
+        write(m_token.m_value[0]);
+        m_open = m_break = m_force = m_space = false;
+        break;
+
+    case TokenTypes::Comma:
+        if (m_force)
+            line_break();
+        write(',');
+        m_break = true;
+        m_space = false;
+        break;
+
+    case TokenTypes::Colon:
+        if (m_force)
+            line_break();
+        // the space after the colon is written with whatever comes next
+        write(':');
+        m_space = true;
+        break;
+
+    case TokenTypes::LineComment:
+    case TokenTypes::BlockComment: {
+        if (!m_options.m_keep_comments)
+            break;
+
+        bool ownLine = m_break || m_force;
+        if (ownLine)
+            line_break();
+        else if (m_started && !m_options.m_minify)
+            write(' ');
+        write(m_data + m_token.m_pos, m_token.m_len);
+        m_open = false;
+
+        if (m_token.m_type == TokenTypes::LineComment) {
+            m_force = true;
+        } else {
+            // keep whatever follows a comment on its own line there too
+            m_break = ownLine;
+            m_space = !ownLine;
+        }
+        break;
+    }
+
+    case TokenTypes::String:
+        begin_value();
+        write_string();
+        break;
+
+    case TokenTypes::Number:
+    case TokenTypes::Bool:
+    case TokenTypes::Null:
+        begin_value();
+        write(m_data + m_token.m_pos, m_token.m_len);
+        break;
+
+    default:
+        break;
+    }
+}
+
+void json_parser::Formatter::format(const char *data, size_t len, std::ostream &out) {
+    m_lexer.reset(data, len);
+    m_data = data;
+    m_stream = &out;
+    m_out.clear();
+    m_closers.clear();
+    m_open = m_break = m_force = m_space = m_started = false;
+
+    while (m_lexer.next(m_token)->m_type != TokenTypes::EOFToken)
+        write_token();
+
+    if (!m_closers.empty())
+        Lexer::error("Unclosed object or array", m_token.m_row, m_token.m_col);
+    if (m_force)
+        m_out += '\n';
+    flush();
+}
+void json_parser::Formatter::format(const std::string &data, std::ostream &out) {
+    format(data.data(), data.length(), out);
+}
+std::string json_parser::Formatter::format(const std::string &data) {
+    std::ostringstream out;
+    format(data, out);
+    return out.str();
+}
@@ -0,0 +1,226 @@
+#include "frozen.hpp"
+#include "escape.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+    const size_t npos = std::string::npos;
+    const std::string EMPTY;
+}
+
+/* FrozenValue */
+json_parser::FrozenValue::FrozenValue(const FrozenDoc *doc, size_t idx)
+    : m_doc(doc), m_idx(idx) {}
+
+bool json_parser::FrozenValue::exists() const {
+    return m_idx != npos;
+}
+json_parser::JsonTypes json_parser::FrozenValue::get_type() const {
+    // a missing value reads as null
+    return exists() ? m_doc->m_nodes[m_idx].m_type : JsonTypes::JsonNull;
+}
+bool json_parser::FrozenValue::is_null() const {
+    return get_type() == JsonTypes::JsonNull;
+}
+
+const std::string &json_parser::FrozenValue::get_string() const {
+    if (get_type() != JsonTypes::JsonString)
+        return EMPTY;
+    return m_doc->m_strings[m_doc->m_nodes[m_idx].m_offset];
+}
+double json_parser::FrozenValue::get_number() const {
+    return get_type() == JsonTypes::JsonNumber ? m_doc->m_nodes[m_idx].m_number : 0;
+}
+bool json_parser::FrozenValue::get_bool() const {
+    return get_type() == JsonTypes::JsonBool && m_doc->m_nodes[m_idx].m_size;
+}
+
+size_t json_parser::FrozenValue::size() const {
+    JsonTypes type = get_type();
+    if (type != JsonTypes::JsonArray && type != JsonTypes::JsonObj)
+        return 0;
+    return m_doc->m_nodes[m_idx].m_size;
+}
+json_parser::FrozenValue json_parser::FrozenValue::get(const std::string &key) const {
+    if (get_type() != JsonTypes::JsonObj)
+        return FrozenValue(m_doc, npos);
+
+    const FrozenDoc::Node &node = m_doc->m_nodes[m_idx];
+    auto first = m_doc->m_sorted.begin() + node.m_offset;
+    auto last = first + node.m_size;
+    auto it = std::lower_bound(first, last, key, [&](size_t member, const std::string &val) {
+        return m_doc->m_strings[m_doc->m_keys[node.m_offset + member]] < val;
+    });
+
+    if (it == last || m_doc->m_strings[m_doc->m_keys[node.m_offset + *it]] != key)
+        return FrozenValue(m_doc, npos);
+    return FrozenValue(m_doc, m_doc->m_children[node.m_offset + *it]);
+}
+json_parser::FrozenValue json_parser::FrozenValue::operator[](const std::string &key) const {
+    return get(key);
+}
+json_parser::FrozenValue json_parser::FrozenValue::operator[](size_t idx) const {
+    if (get_type() != JsonTypes::JsonArray || idx >= size())
+        return FrozenValue(m_doc, npos);
+    return FrozenValue(m_doc, m_doc->m_children[m_doc->m_nodes[m_idx].m_offset + idx]);
+}
+const std::string &json_parser::FrozenValue::key_at(size_t idx) const {
+    if (get_type() != JsonTypes::JsonObj || idx >= size())
+        return EMPTY;
+    return m_doc->m_strings[m_doc->m_keys[m_doc->m_nodes[m_idx].m_offset + idx]];
+}
+json_parser::FrozenValue json_parser::FrozenValue::value_at(size_t idx) const {
+    if (get_type() != JsonTypes::JsonObj || idx >= size())
+        return FrozenValue(m_doc, npos);
+    return FrozenValue(m_doc, m_doc->m_children[m_doc->m_nodes[m_idx].m_offset + idx]);
+}
+
+std::string json_parser::FrozenValue::to_string(const std::string &indent) const {
+    // the same layout as the tree's to_string
+    switch (get_type()) {
+    case JsonTypes::JsonString: {
+        const std::string &str = get_string();
+        std::string result;
+        result.reserve(str.length() + 2);
+        result += '"';
+        escape_string(str.data(), str.length(), result);
+        result += '"';
+        return result;
+    }
+    case JsonTypes::JsonNumber:
+        return std::to_string(get_number());
+    case JsonTypes::JsonBool:
+        return get_bool() ? "true" : "false";
+    case JsonTypes::JsonArray:
+    case JsonTypes::JsonObj: {
+        bool isObj = get_type() == JsonTypes::JsonObj;
+        size_t count = size();
+        if (!count)
+            return isObj ? "{}" : "[]";
+
+        std::string result = isObj ? "{\n" : "[\n";
+        for (size_t i = 0; i < count; i++) {
+            result += indent + "    ";
+            if (isObj) {
+                std::string escaped;
+                escape_string(key_at(i).data(), key_at(i).length(), escaped);
+                result += '"' + escaped + "\": " + value_at(i).to_string(indent + "    ");
+            } else {
+                result += (*this)[i].to_string(indent + "    ");
+            }
+            if (i + 1 < count)
+                result += ',';
+            result += '\n';
+        }
+        result += indent + (isObj ? '}' : ']');
+        return result;
+    }
+    default:
+        return "null";
+    }
+}
+
+/* FrozenDoc */
+json_parser::FrozenDoc::FrozenDoc(Object *root) {
+    add(root);
+}
+
+size_t json_parser::FrozenDoc::add_string(const std::string &str) {
+    m_strings.push_back(str);
+    return m_strings.size() - 1;
+}
+size_t json_parser::FrozenDoc::add(Object *obj) {
+    size_t idx = m_nodes.size();
+    m_nodes.push_back({ obj->get_type(), 0, 0, 0 });
+
+    switch (obj->get_type()) {
+    case JsonTypes::JsonString:
+        m_nodes[idx].m_offset = add_string(dynamic_cast<JsonString*>(obj)->get_value());
+        break;
+    case JsonTypes::JsonNumber:
+        m_nodes[idx].m_number = dynamic_cast<JsonNumber*>(obj)->m_val;
+        break;
+    case JsonTypes::JsonBool:
+        m_nodes[idx].m_size = dynamic_cast<JsonBool*>(obj)->m_val;
+        break;
+    case JsonTypes::JsonArray: {
+        // claim a block of slots, then fill it as the elements are added
+        JsonArray *array = dynamic_cast<JsonArray*>(obj);
+        size_t count = array->size();
+        size_t offset = m_children.size();
+        m_nodes[idx].m_offset = offset;
+        m_nodes[idx].m_size = count;
+        m_children.resize(offset + count);
+        m_keys.resize(offset + count, npos);
+        m_sorted.resize(offset + count);
+
+        // packed arrays are read without boxing them
+        for (size_t i = 0; i < count; i++) {
+            size_t child;
+            if (array->get_storage() == ArrayStorage::Numbers) {
+                child = m_nodes.size();
+                m_nodes.push_back({ JsonTypes::JsonNumber, 0, 0, array->numbers()[i] });
+            } else if (array->get_storage() == ArrayStorage::Bools) {
+                child = m_nodes.size();
+                m_nodes.push_back({ JsonTypes::JsonBool, 0, array->bools()[i], 0 });
+            } else {
+                child = add((*array)[i]);
+            }
+            m_children[offset + i] = child;
+        }
+        break;
+    }
+    case JsonTypes::JsonObj: {
+        JsonObj *object = dynamic_cast<JsonObj*>(obj);
+        size_t count = object->size();
+        size_t offset = m_children.size();
+        m_nodes[idx].m_offset = offset;
+        m_nodes[idx].m_size = count;
+        m_children.resize(offset + count);
+        m_keys.resize(offset + count);
+        m_sorted.resize(offset + count);
+
+        for (size_t i = 0; i < count; i++) {
+            m_keys[offset + i] = add_string(object->key_at(i)->get_value());
+            size_t child = add(object->value_at(i));
+            m_children[offset + i] = child;
+            m_sorted[offset + i] = i;
+        }
+
+        auto first = m_sorted.begin() + offset;
+        std::sort(first, first + count, [&](size_t a, size_t b) {
+            return m_strings[m_keys[offset + a]] < m_strings[m_keys[offset + b]];
+        });
+        break;
+    }
+    default:
+        break;
+    }
+    return idx;
+}
+
+json_parser::FrozenValue json_parser::FrozenDoc::get_root() const {
+    return FrozenValue(this, m_nodes.empty() ? npos : 0);
+}
+std::string json_parser::FrozenDoc::to_string() const {
+    return get_root().to_string("");
+}
+
+std::shared_ptr<const json_parser::FrozenDoc> json_parser::freeze(Object *root) {
+    return std::make_shared<const FrozenDoc>(root);
+}
+
+/* DocSnapshot */
+json_parser::DocSnapshot::DocSnapshot(std::shared_ptr<const FrozenDoc> doc)
+    : m_doc(doc) {}
+
+std::shared_ptr<const json_parser::FrozenDoc> json_parser::DocSnapshot::load() const {
+    return std::atomic_load(&m_doc);
+}
+void json_parser::DocSnapshot::store(std::shared_ptr<const FrozenDoc> doc) {
+    std::atomic_store(&m_doc, doc);
+}
+std::shared_ptr<const json_parser::FrozenDoc> json_parser::DocSnapshot::exchange(std::shared_ptr<const FrozenDoc> doc) {
+    return std::atomic_exchange(&m_doc, doc);
+}
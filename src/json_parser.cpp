@@ -1,13 +1,46 @@
 #include "json_parser.hpp"
 
-json_parser::JsonDoc::JsonDoc(const std::string &data) {
-    Parser parser(data);
+json_parser::JsonDoc::JsonDoc(const std::string &data, ParseStats *stats)
+    : m_source(data), m_stats(stats) {
+    // strings stay in m_source until read
+    Parser parser;
+    parser.reset(m_source.data(), m_source.length(), stats);
+    root = parser.parse();
+}
+json_parser::JsonDoc::JsonDoc(const std::string &data, const std::vector<std::string> &paths, ParseStats *stats)
+    : m_source(data), m_stats(stats) {
+    Parser parser;
+    parser.set_projection(paths);
+    parser.reset(m_source.data(), m_source.length(), stats);
+    root = parser.parse();
+}
+json_parser::JsonDoc::JsonDoc(Parser &parser, const std::string &data, ParseStats *stats)
+    : m_source(data), m_stats(stats) {
+    parser.reset(m_source.data(), m_source.length(), stats);
     root = parser.parse();
 }
 json_parser::JsonDoc::~JsonDoc() {
     delete root;
 }
 
+json_parser::JsonObj *json_parser::JsonDoc::get_root() {
+    return root;
+}
+
 std::string json_parser::JsonDoc::to_string() {
+    StatsTimer timer(m_stats ? &m_stats->m_serialize_ns : nullptr);
     return root->to_string_comments("");
 }
+std::string json_parser::JsonDoc::to_string_preserved() {
+    StatsTimer timer(m_stats ? &m_stats->m_serialize_ns : nullptr);
+    return write_preserved(root, m_source);
+}
+std::shared_ptr<const json_parser::FrozenDoc> json_parser::JsonDoc::freeze() {
+    return json_parser::freeze(root);
+}
+json_parser::MemoryUsage json_parser::JsonDoc::memory_usage() {
+    MemoryUsage usage = root->memory_usage();
+    usage.m_nodes += sizeof(JsonDoc);
+    usage.m_strings += string_heap_bytes(m_source);
+    return usage;
+}
@@ -0,0 +1,412 @@
+#include "lexer.hpp"
+#include "utf8.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+/* Utils */
+std::string json_parser::token_type_to_string(TokenTypes type) {
+    switch (type) {
+    case TokenTypes::String:
+        return "String";
+    case TokenTypes::Number:
+        return "Number";
+    case TokenTypes::Bool:
+        return "Bool";
+    case TokenTypes::Null:
+        return "Null";
+    case TokenTypes::OpenBrace:
+        return "Open Brace";
+    case TokenTypes::CloseBrace:
+        return "Close Brace";
+    case TokenTypes::Colon:
+        return "Colon";
+    case TokenTypes::OpenBracket:
+        return "Open Bracket";
+    case TokenTypes::CloseBracket:
+        return "Close Bracket";
+    case TokenTypes::Comma:
+        return "Comma";
+    case TokenTypes::LineComment:
+        return "Line Comment";
+    case TokenTypes::BlockComment:
+        return "Block Comment";
+    case TokenTypes::EOFToken:
+        return "EOF Token";
+    case TokenTypes::WhiteSpace:
+        return "White Space";
+    case TokenTypes::BadToken:
+        return "Bad Token";
+    default:
+        throw std::runtime_error("Unrecognised TokenType: " + std::to_string((int)type));
+    }
+}
+
+/* Token */
+json_parser::Token::Token(TokenTypes type, char value, size_t pos, size_t row, size_t col)
+    : Token(type, std::string(1, value), pos, row, col) {}
+json_parser::Token::Token(TokenTypes type, const std::string &value, size_t pos, size_t row, size_t col) {
+    m_type = type;
+    m_value = value;
+    m_pos = pos;
+    m_len = value.length();
+    m_escaped = false;
+    m_row = row;
+    m_col = col;
+}
+
+std::string json_parser::Token::to_string() {
+    return 
+        "row: " + std::to_string(m_row) +
+        " col: " + std::to_string(m_col) +
+        " type: " + token_type_to_string(m_type) +
+        " value: " + m_value;
+}
+/* Lexer */
+char json_parser::Lexer::current_chr() {
+    return m_pos < m_len ? m_data[m_pos] : '\0';
+}
+char json_parser::Lexer::next_chr() {
+    m_pos++;
+    m_col++;
+    if (eof())
+        return '\0';
+    char c = m_data[m_pos];
+    if (c == '\n' || c == '\r') {
+        m_row++;
+        m_col = 1;
+    }
+    return c;
+}
+
+void json_parser::Lexer::advance(size_t count) {
+    // same as count calls to next_chr over a run without newlines, bar the last
+    m_pos += count - 1;
+    m_col += count - 1;
+    next_chr();
+}
+
+bool json_parser::Lexer::eof() {
+    return m_pos >= m_len;
+}
+
+json_parser::Token *json_parser::Lexer::make_token(TokenTypes type, size_t pos, size_t row, size_t col) {
+    Token *token = m_token;
+    token->m_type = type;
+    token->m_value.clear();
+    token->m_escaped = false;
+    token->m_pos = pos;
+    token->m_row = row;
+    token->m_col = col;
+    return token;
+}
+json_parser::Token *json_parser::Lexer::make_token(TokenTypes type, char value, size_t pos, size_t row, size_t col) {
+    Token *token = make_token(type, pos, row, col);
+    token->m_value.assign(1, value);
+    return token;
+}
+
+void json_parser::Lexer::error(std::string msg, size_t line, size_t col) {
+    throw std::runtime_error(
+        "Fatal error at: line " +
+            std::to_string(line) +
+        ", col " +
+            std::to_string(col) +
+        ":\n" + msg
+    );
+}
+
+void json_parser::Lexer::lex_escape(std::string &str) {
+    switch (current_chr()) {
+    case '"': str += '"'; break;
+    case '\\': str += '\\'; break;
+    case '/': str += '/'; break;
+    case 'b': str += '\b'; break;
+    case 'f': str += '\f'; break;
+    case 'n': str += '\n'; break;
+    case 'r': str += '\r'; break;
+    case 't': str += '\t'; break;
+    case 'u': {
+        uint32_t code = lex_hex4();
+
+        // characters outside the BMP are written as a surrogate pair
+        if (code >= 0xD800 && code <= 0xDBFF) {
+            if (next_chr() != '\\' || next_chr() != 'u')
+                error("Unpaired surrogate in \\u escape", m_row, m_col);
+            uint32_t low = lex_hex4();
+            if (low < 0xDC00 || low > 0xDFFF)
+                error("Unpaired surrogate in \\u escape", m_row, m_col);
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        } else if (code >= 0xDC00 && code <= 0xDFFF) {
+            error("Unpaired surrogate in \\u escape", m_row, m_col);
+        }
+
+        append_utf8(str, code);
+        break;
+    }
+    default:
+        error("Unrecognised escape sequence", m_row, m_col);
+    }
+    next_chr();
+}
+uint32_t json_parser::Lexer::lex_hex4() {
+    uint32_t code = 0;
+    for (int i = 0; i < 4; i++) {
+        unsigned char c = next_chr();
+        if (!isxdigit(c))
+            error("\\u must be followed by 4 hex digits", m_row, m_col);
+        code = code * 16 + (isdigit(c) ? c - '0' : tolower(c) - 'a' + 10);
+    }
+    return code;
+}
+void json_parser::Lexer::check_utf8(Token *token) {
+    const std::string &value = token->m_value;
+    if (validate_utf8(value.data(), value.length()) != value.length())
+        error("Invalid UTF-8 in " + token_type_to_string(token->m_type), token->m_row, token->m_col);
+}
+
+json_parser::Token *json_parser::Lexer::get_next_token() {
+    size_t start = m_pos;
+    size_t startRow = m_row;
+    size_t startCol = m_col;
+    char startChr = current_chr();
+
+    // misc: eof token
+    if (eof()) {
+        next_chr();
+        return make_token(TokenTypes::EOFToken, current_chr(), start, startRow, startCol);
+    }
+
+    // misc: whitespace token
+    if (isspace(current_chr())) {
+        while (!eof() && isspace(current_chr()))
+            next_chr();
+        Token *token = make_token(TokenTypes::WhiteSpace, start, startRow, startCol);
+        token->m_value.assign(m_data + start, m_pos - start);
+        return token;
+    }
+
+    // comments
+    if (current_chr() == '/') {
+        // comments: line comment
+        next_chr();
+        if (current_chr() == '/') {
+            next_chr();
+            while (!eof() && current_chr() != '\n' && current_chr() != '\r')
+                next_chr();
+            // dont include the // slashes
+            Token *token = make_token(TokenTypes::LineComment, start, startRow, startCol);
+            token->m_value.assign(m_data + start+2, m_pos-start-2);
+            check_utf8(token);
+            return token;
+        }
+        
+        // comments: block comment
+        else if (current_chr() == '*') {
+            bool hasClosingTag = false;
+
+            next_chr();
+            while (!eof()) {
+                // if there is space for closing */
+                if (m_pos+1 < m_len &&
+                    m_data[m_pos] == '*' && m_data[m_pos+1] == '/') {
+                    next_chr();
+                    next_chr();
+                    hasClosingTag = true;
+                    break;
+                }
+                next_chr();
+            }
+            
+            // dont include the // slashes
+            Token *token = make_token(TokenTypes::BlockComment, start, startRow, startCol);
+            token->m_value.assign(m_data + start+2, m_pos - hasClosingTag*2 - start - 2);
+            check_utf8(token);
+            return token;
+        }
+    }
+    
+    // objects: open & close braces and colons
+    if (current_chr() == '{') {
+        next_chr();
+        return make_token(TokenTypes::OpenBrace, startChr, start, startRow, startCol);
+    }
+    if (current_chr() == '}') {
+        next_chr();
+        return make_token(TokenTypes::CloseBrace, startChr, start, startRow, startCol);
+    }
+    if (current_chr() == ':') {
+        next_chr();
+        return make_token(TokenTypes::Colon, startChr, start, startRow, startCol);
+    }
+
+    // arrays: open & close brackets and commas
+    if (current_chr() == '[') {
+        next_chr();
+        return make_token(TokenTypes::OpenBracket, startChr, start, startRow, startCol);
+    }
+    if (current_chr() == ']') {
+        next_chr();
+        return make_token(TokenTypes::CloseBracket, startChr, start, startRow, startCol);
+    }
+    if (current_chr() == ',') {
+        next_chr();
+        return make_token(TokenTypes::Comma, startChr, start, startRow, startCol);
+    }
+
+    // types: string
+    if (current_chr() == '"') {
+        // decode straight into the (reused) token value, or only validate
+        // when the caller works from the raw text
+        Token *token = make_token(TokenTypes::String, start, startRow, startCol);
+        std::string &str = m_decode ? token->m_value : m_scratch;
+        next_chr();
+
+        // loop till closing quote or eof
+        while (!eof() && current_chr() != '"') {
+            // bulk copy runs of plain ascii, the common case
+            size_t run = string_run_length(m_data + m_pos, m_len - m_pos);
+            if (run) {
+                if (m_decode)
+                    str.append(m_data + m_pos, run);
+                advance(run);
+                continue;
+            }
+
+            if (current_chr() == '\\') {
+                token->m_escaped = true;
+                next_chr();
+                lex_escape(str);
+                if (!m_decode)
+                    str.clear();
+            } else if ((unsigned char)current_chr() >= 0x80) {
+                size_t len = utf8_sequence_length(m_data + m_pos, m_len - m_pos);
+                if (!len)
+                    error("Invalid UTF-8 in string", m_row, m_col);
+                if (m_decode)
+                    str.append(m_data + m_pos, len);
+                // a code point is a single column
+                m_col -= len - 1;
+                advance(len);
+            } else {
+                // newlines, left to next_chr so rows are counted
+                if (m_decode)
+                    str += current_chr();
+                next_chr();
+            }
+        }
+
+        // reached end of string
+        if (!eof()) {
+            next_chr();
+            return token;
+        }
+
+        // no closing quote
+        error("No closing quote for string", m_row, m_col);
+    }
+    
+    // types: number
+    if (isdigit(current_chr()) || current_chr() == '-') {
+        // advance so that the - is not considered
+        next_chr();
+
+        // integer
+        while (!eof() && isdigit(current_chr()))
+            next_chr();
+
+        // fraction
+        if (current_chr() == '.') {
+            next_chr();
+
+            // decimal places
+            if (isdigit(current_chr())) {
+                while (!eof() && isdigit(current_chr()))
+                    next_chr();
+            } else {
+                error("A decimal point must be followed by digits", m_row, m_col);
+            }
+        }
+
+        // exponent
+        if (tolower(current_chr()) == 'e') {
+            next_chr();
+            if (current_chr() == '-'||current_chr()=='+')
+                next_chr();
+            if (isdigit(current_chr())) {
+                while (!eof() && isdigit(current_chr()))
+                    next_chr();
+            } else {
+                error("Exponent must be followed by an integer", m_row, m_col);
+            }
+        }
+
+        Token *token = make_token(TokenTypes::Number, start, startRow, startCol);
+        token->m_value.assign(m_data + start, m_pos - start);
+        return token;
+    }
+
+    // check there is space for word
+    if (m_pos+3 < m_len) {
+        if (m_pos+4 < m_len) {
+            if (memcmp(m_data + start, "false", 5) == 0) {
+                m_pos += 5;
+                m_col += 5;
+                Token *token = make_token(TokenTypes::Bool, start, startRow, startCol);
+                token->m_value.assign("false");
+                return token;
+            }
+        }
+        
+        // types: bool (true)
+        if (memcmp(m_data + start, "true", 4) == 0) {
+            m_pos += 4;
+            m_col += 4;
+            Token *token = make_token(TokenTypes::Bool, start, startRow, startCol);
+            token->m_value.assign("true");
+            return token;
+        }
+        // types: null
+        if (memcmp(m_data + start, "null", 4) == 0) {
+            m_pos += 4;
+            m_col += 4;
+            Token *token = make_token(TokenTypes::Null, start, startRow, startCol);
+            token->m_value.assign("null");
+            return token;
+        }
+    }
+
+    // misc: EOF token
+    error(std::string("Bad Token: ") + startChr, m_row, m_col);
+    next_chr();
+    return make_token(TokenTypes::BadToken, startChr, start, startRow, startCol);
+}
+
+json_parser::Lexer::Lexer()
+    : Lexer(nullptr, 0) {}
+json_parser::Lexer::Lexer(const char *data, size_t len)
+    : m_decode(true) {
+    reset(data, len);
+}
+
+void json_parser::Lexer::set_decode(bool decode) {
+    m_decode = decode;
+}
+
+void json_parser::Lexer::reset(const char *data, size_t len) {
+    m_data = data;
+    m_len = len;
+    m_pos = 0;
+    m_row = 1;
+    m_col = 1;
+    m_token = nullptr;
+}
+
+json_parser::Token *json_parser::Lexer::next(Token &token) {
+    m_token = &token;
+    get_next_token();
+    token.m_len = std::min(m_pos, m_len) - token.m_pos;
+    return m_token;
+}
@@ -0,0 +1,97 @@
+#if !defined(JSONPARSER_LEXER_HPP)
+#define JSONPARSER_LEXER_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace json_parser {
+
+enum class TokenTypes {
+    // types
+    String,
+    Number,
+    Bool,
+    Null,
+
+    // objects
+    OpenBrace,    // {
+    CloseBrace,   // }
+    Colon,        // :
+
+    // arrays
+    OpenBracket,  // [
+    CloseBracket, // ]
+    Comma,        // ,
+
+    // comments
+    LineComment,  // //comment
+    BlockComment, // /* comment */
+
+    // misc
+    EOFToken,
+    WhiteSpace,
+    BadToken
+};
+
+std::string token_type_to_string(TokenTypes type);
+
+struct Token {
+    TokenTypes m_type;
+    std::string m_value;
+    size_t m_row, m_col, m_pos;
+    // length of the token in the input, m_value is decoded
+    size_t m_len;
+    // a string token contained escape sequences
+    bool m_escaped;
+
+    Token(TokenTypes type, char value, size_t pos, size_t row, size_t col);
+    Token(TokenTypes type, const std::string &value, size_t pos, size_t row, size_t col);
+
+    std::string to_string();
+};
+
+// Splits a buffer into tokens one at a time. The buffer is not copied and
+// must outlive the lexer.
+class Lexer {
+private:
+    const char *m_data;
+    size_t m_len;
+    size_t m_pos, m_row, m_col;
+    Token *m_token;
+
+    // whether string tokens get a decoded m_value
+    bool m_decode;
+    std::string m_scratch;
+
+    char current_chr();
+    char next_chr();
+    void advance(size_t count);
+    bool eof();
+
+    void lex_escape(std::string &str);
+    uint32_t lex_hex4();
+    void check_utf8(Token *token);
+
+    Token *make_token(TokenTypes type, size_t pos, size_t row, size_t col);
+    Token *make_token(TokenTypes type, char value, size_t pos, size_t row, size_t col);
+    Token *get_next_token();
+
+public:
+    Lexer();
+    Lexer(const char *data, size_t len);
+
+    void reset(const char *data, size_t len);
+    // when off, string tokens are validated but m_value is left empty, for
+    // callers that use the raw text at m_pos. On by default
+    void set_decode(bool decode);
+
+    // lexes the next token into token, reusing its value buffer. Returns
+    // EOFToken repeatedly once the input is exhausted
+    Token *next(Token &token);
+
+    static void error(std::string msg, size_t line, size_t col);
+};
+
+}
+
+#endif // JSONPARSER_LEXER_HPP
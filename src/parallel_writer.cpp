@@ -0,0 +1,275 @@
+#include "parallel_writer.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/uio.h>
+
+namespace {
+    const size_t npos = std::string::npos;
+
+    // a guess at std::to_string of a double, which writes 6 decimals
+    const size_t NUMBER_ESTIMATE = 10;
+
+#if defined(IOV_MAX)
+    const size_t MAX_IOVECS = IOV_MAX;
+#else
+    const size_t MAX_IOVECS = 1024;
+#endif
+
+    bool is_container(json_parser::Object *obj) {
+        json_parser::JsonTypes type = obj->get_type();
+        return type == json_parser::JsonTypes::JsonArray || type == json_parser::JsonTypes::JsonObj;
+    }
+}
+
+/* ParallelWriter */
+json_parser::ParallelWriter::ParallelWriter(size_t threads, size_t split_size)
+    : m_threads(threads ? threads : std::thread::hardware_concurrency()),
+      m_split_size(split_size) {
+    if (!m_threads)
+        m_threads = 1;
+}
+
+size_t json_parser::ParallelWriter::estimate(Object *obj, size_t depth) {
+    auto it = m_estimates.find(obj);
+    if (it != m_estimates.end())
+        return it->second;
+
+    size_t indent = depth * 4;
+    size_t bytes = 0;
+
+    for (Object *comment : obj->m_comment_before)
+        bytes += comment->to_string("").length() + indent;
+    for (Object *comment : obj->m_comment_after)
+        bytes += comment->to_string("").length() + indent;
+
+    // each member line is the deeper indent, the member, ",\n"
+    size_t line = indent + 4 + 2;
+
+    switch (obj->get_type()) {
+    case JsonTypes::JsonString:
+        bytes += dynamic_cast<JsonString*>(obj)->text_length() + 2;
+        break;
+    case JsonTypes::JsonNumber:
+        bytes += NUMBER_ESTIMATE;
+        break;
+    case JsonTypes::JsonBool:
+        bytes += 5;
+        break;
+    case JsonTypes::JsonArray: {
+        JsonArray *array = dynamic_cast<JsonArray*>(obj);
+        size_t count = array->size();
+        bytes += indent + 3;
+
+        if (array->get_storage() == ArrayStorage::Numbers) {
+            bytes += count * (line + NUMBER_ESTIMATE);
+        } else if (array->get_storage() == ArrayStorage::Bools) {
+            bytes += count * (line + 5);
+        } else {
+            for (size_t i = 0; i < count; i++)
+                bytes += line + estimate((*array)[i], depth + 1);
+        }
+        break;
+    }
+    case JsonTypes::JsonObj: {
+        JsonObj *object = dynamic_cast<JsonObj*>(obj);
+        bytes += indent + 3;
+        for (size_t i = 0; i < object->size(); i++) {
+            bytes +=
+                line + 2 +
+                estimate(object->key_at(i), depth + 1) +
+                estimate(object->value_at(i), depth + 1);
+        }
+        break;
+    }
+    default:
+        bytes += 4;
+        break;
+    }
+
+    if (bytes >= m_split_size)
+        m_estimates[obj] = bytes;
+    return bytes;
+}
+
+std::string &json_parser::ParallelWriter::text() {
+    if (m_segments.empty() || m_segments.back().m_node)
+        m_segments.push_back({ "", nullptr, 0, 0, "" });
+    return m_segments.back().m_text;
+}
+void json_parser::ParallelWriter::add_run(Object *node, size_t begin, size_t end, const std::string &indent) {
+    m_segments.push_back({ "", node, begin, end, indent });
+}
+
+void json_parser::ParallelWriter::split(Object *obj, const std::string &indent) {
+    // the same output as to_string_comments, with the members left to runs
+    JsonArray *array = dynamic_cast<JsonArray*>(obj);
+    size_t count = array ? array->size() : 0;
+    if (!array && obj->get_type() == JsonTypes::JsonObj)
+        count = dynamic_cast<JsonObj*>(obj)->size();
+
+    if (!count || estimate(obj, indent.length() / 4) < m_split_size) {
+        add_run(obj, 0, npos, indent);
+        return;
+    }
+
+    for (Object *comment : obj->m_comment_before)
+        text() += comment->to_string("") + indent;
+    text() += array ? "[\n" : "{\n";
+
+    split_members(obj, indent);
+
+    text() += indent + (array ? ']' : '}');
+    for (Object *comment : obj->m_comment_after)
+        text() += indent + comment->to_string("");
+}
+void json_parser::ParallelWriter::split_members(Object *obj, const std::string &indent) {
+    JsonArray *array = dynamic_cast<JsonArray*>(obj);
+    JsonObj *object = dynamic_cast<JsonObj*>(obj);
+    bool boxed = !array || array->get_storage() == ArrayStorage::Boxed;
+    size_t count = array ? array->size() : object->size();
+    size_t depth = indent.length() / 4 + 1;
+
+    // consecutive members are gathered into runs of about the split size,
+    // large containers among them are split in turn
+    size_t start = 0, bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        Object *child = !boxed ? nullptr : array ? (*array)[i] : object->value_at(i);
+        size_t size = child ? estimate(child, depth) : NUMBER_ESTIMATE;
+
+        if (child && is_container(child) && size >= m_split_size) {
+            if (start < i)
+                add_run(obj, start, i, indent);
+
+            text() += indent + "    ";
+            if (object)
+                text() += object->key_at(i)->to_string_comments(indent + "    ") + ": ";
+            split(child, indent + "    ");
+            text() += i + 1 < count ? ",\n" : "\n";
+
+            start = i + 1;
+            bytes = 0;
+            continue;
+        }
+
+        bytes += size;
+        if (bytes >= m_split_size) {
+            add_run(obj, start, i + 1, indent);
+            start = i + 1;
+            bytes = 0;
+        }
+    }
+
+    if (start < count)
+        add_run(obj, start, count, indent);
+}
+
+void json_parser::ParallelWriter::run_segments() {
+    std::vector<Segment*> runs;
+    for (Segment &segment : m_segments) {
+        if (segment.m_node)
+            runs.push_back(&segment);
+    }
+
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        for (size_t i = next++; i < runs.size(); i = next++) {
+            Segment &run = *runs[i];
+            if (run.m_end == npos) {
+                run.m_text = run.m_node->to_string_comments(run.m_indent);
+            } else if (JsonArray *array = dynamic_cast<JsonArray*>(run.m_node)) {
+                array->append_elements(run.m_text, run.m_begin, run.m_end, run.m_indent);
+            } else {
+                dynamic_cast<JsonObj*>(run.m_node)->append_elements(
+                    run.m_text, run.m_begin, run.m_end, run.m_indent);
+            }
+        }
+    };
+
+    // the calling thread takes a share, errors are rethrown once all stop
+    size_t count = std::min(m_threads, runs.size());
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(count);
+    for (size_t t = 0; t < count; t++) {
+        auto guarded = [&, t]() {
+            try {
+                work();
+            } catch (...) {
+                errors[t] = std::current_exception();
+                next = runs.size();
+            }
+        };
+        if (t + 1 < count)
+            threads.emplace_back(guarded);
+        else
+            guarded();
+    }
+    for (std::thread &thread : threads)
+        thread.join();
+
+    for (std::exception_ptr &error : errors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+}
+
+void json_parser::ParallelWriter::prepare(Object *root) {
+    m_segments.clear();
+    m_estimates.clear();
+    split(root, "");
+    run_segments();
+}
+
+std::string json_parser::ParallelWriter::write(Object *root) {
+    prepare(root);
+
+    size_t total = 0;
+    for (Segment &segment : m_segments)
+        total += segment.m_text.length();
+
+    std::string result;
+    result.reserve(total);
+    for (Segment &segment : m_segments)
+        result += segment.m_text;
+
+    m_segments.clear();
+    return result;
+}
+void json_parser::ParallelWriter::write(Object *root, int fd) {
+    prepare(root);
+
+    std::vector<iovec> iovecs;
+    for (Segment &segment : m_segments) {
+        if (!segment.m_text.empty())
+            iovecs.push_back({ &segment.m_text[0], segment.m_text.length() });
+    }
+
+    // writev may stop part way, so resume from wherever it got to
+    size_t first = 0;
+    while (first < iovecs.size()) {
+        size_t count = std::min(MAX_IOVECS, iovecs.size() - first);
+        ssize_t written = writev(fd, &iovecs[first], count);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            m_segments.clear();
+            throw std::runtime_error(std::string("writev failed: ") + strerror(errno));
+        }
+
+        size_t left = written;
+        while (first < iovecs.size() && left >= iovecs[first].iov_len)
+            left -= iovecs[first++].iov_len;
+        if (left) {
+            iovecs[first].iov_base = static_cast<char*>(iovecs[first].iov_base) + left;
+            iovecs[first].iov_len -= left;
+        }
+    }
+
+    m_segments.clear();
+}
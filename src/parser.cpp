@@ -1,86 +1,15 @@
 #include "parser.hpp"
+#include "escape.hpp"
+#include "stats.hpp"
 
 #include <stdexcept>
 #include <string>
 
-/* Utils */
-std::string json_parser::token_type_to_string(TokenTypes type) {
-    switch (type) {
-    case TokenTypes::String:
-        return "String";
-    case TokenTypes::Number:
-        return "Number";
-    case TokenTypes::Bool:
-        return "Bool";
-    case TokenTypes::Null:
-        return "Null";
-    case TokenTypes::OpenBrace:
-        return "Open Brace";
-    case TokenTypes::CloseBrace:
-        return "Close Brace";
-    case TokenTypes::Colon:
-        return "Colon";
-    case TokenTypes::OpenBracket:
-        return "Open Bracket";
-    case TokenTypes::CloseBracket:
-        return "Close Bracket";
-    case TokenTypes::Comma:
-        return "Comma";
-    case TokenTypes::LineComment:
-        return "Line Comment";
-    case TokenTypes::BlockComment:
-        return "Block Comment";
-    case TokenTypes::EOFToken:
-        return "EOF Token";
-    case TokenTypes::WhiteSpace:
-        return "White Space";
-    case TokenTypes::BadToken:
-        return "Bad Token";
-    default:
-        throw std::runtime_error("Unrecognised TokenType: " + std::to_string((int)type));
-    }
-}
-
-/* Token */
-json_parser::Token::Token(TokenTypes type, char value, size_t pos, size_t row, size_t col)
-    : Token(type, std::string(1, value), pos, row, col) {}
-json_parser::Token::Token(TokenTypes type, const std::string &value, size_t pos, size_t row, size_t col) {
-    m_type = type;
-    m_value = value;
-    m_pos = pos;
-    m_row = row;
-    m_col = col;
-}
-
-std::string json_parser::Token::to_string() {
-    return 
-        "row: " + std::to_string(m_row) +
-        " col: " + std::to_string(m_col) +
-        " type: " + token_type_to_string(m_type) +
-        " value: " + m_value;
+namespace {
+    const size_t npos = (size_t)-1;
 }
 
 /* Parser */
-char json_parser::Parser::current_chr() {
-    return m_str[m_pos];
-}
-char json_parser::Parser::next_chr() {
-    m_pos++;
-    m_col++;
-    if (eof())
-        return '\0';
-    char c = m_str[m_pos];
-    if (c == '\n' || c == '\r') {
-        m_row++;
-        m_col = 1;
-    }
-    return c;
-}
-
-bool json_parser::Parser::eof() {
-    return m_pos >= m_str.length();
-}
-
 json_parser::Token *json_parser::Parser::current_token() {
     return m_tokens[std::min(m_token_pos, m_tokens.size()-1)];
 }
@@ -109,100 +38,308 @@ json_parser::Token *json_parser::Parser::match_token(TokenTypes type, bool requi
     return nullptr;
 }
 
-json_parser::JsonArray *json_parser::Parser::parse_array() {
+json_parser::JsonArray *json_parser::Parser::open_array() {
     Token *token = match_token(TokenTypes::OpenBracket, true);
 
     JsonArray *result = new JsonArray(token->m_pos);
+    record_node(JsonTypes::JsonArray, sizeof(JsonArray));
+    // an empty span until it is closed, so a value for a repeated key keeps
+    // its own place rather than taking the earlier value's
+    result->m_end = token->m_pos;
+    add_comments(result);
+    return result;
+}
+json_parser::JsonObj *json_parser::Parser::open_object() {
+    Token *token = match_token(TokenTypes::OpenBrace, true);
+
+    JsonObj *result = new JsonObj(token->m_pos);
+    record_node(JsonTypes::JsonObj, sizeof(JsonObj));
+    // an empty span until it is closed, so a value for a repeated key keeps
+    // its own place rather than taking the earlier value's
+    result->m_end = token->m_pos;
     add_comments(result);
+    return result;
+}
 
-    while (current_token()->m_type != TokenTypes::CloseBracket) {
-        result->add_child(parse_object());
-        match_token(TokenTypes::Comma);
+void json_parser::Parser::attach(Object *node) {
+    Frame &top = m_stack.back();
+    if (top.m_array) {
+        top.m_array->add_child(node);
+    } else {
+        top.m_obj->set(top.m_key, node);
+        top.m_key = nullptr;
     }
+}
+bool json_parser::Parser::close_containers() {
+    while (!m_stack.empty()) {
+        Frame &top = m_stack.back();
+        TokenTypes type = current_token()->m_type;
+
+        if (top.m_array) {
+            if (type != TokenTypes::CloseBracket)
+                return true;
+
+            Token *close = match_token(TokenTypes::CloseBracket, true);
+            // building the array is not a change to it
+            top.m_array->m_end = close->m_pos + 1;
+            top.m_array->m_dirty = false;
+            record_container(top.m_array->size());
+        } else {
+            // the next key, the value is parsed by the caller
+            if (type != TokenTypes::EOFToken &&
+                type != TokenTypes::CloseBrace) {
+                if (!select_member(top))
+                    continue;
+                top.m_key = parse_string();
+                match_token(TokenTypes::Colon);
+                return true;
+            }
+
+            Token *close = match_token(TokenTypes::CloseBrace, true);
+            top.m_obj->m_end = close->m_pos + 1;
+            top.m_obj->m_dirty = false;
+            record_container(top.m_obj->size());
+        }
 
-    match_token(TokenTypes::CloseBracket, true);
+        m_stack.pop_back();
 
-    return result;
+        // the closed container was a value in its parent
+        if (!m_stack.empty())
+            match_token(TokenTypes::Comma);
+    }
+    return false;
 }
-json_parser::JsonObj *json_parser::Parser::parse_object() {
-    Token *token = match_token(TokenTypes::OpenBrace, true);
 
-    JsonObj *ret = new JsonObj(token->m_pos);
-    add_comments(ret);
-    
-    while (token->m_type != TokenTypes::EOFToken &&
-           token->m_type != TokenTypes::CloseBrace) {
-        JsonString *key = parse_string();
-        match_token(TokenTypes::Colon);
-        
-        Object *result = nullptr;
-
-        switch (current_token()->m_type) {
-        case TokenTypes::OpenBrace:
-            result = parse_object();
-            break;
-        case TokenTypes::OpenBracket:
-            result = parse_array();
-            break;
-        case TokenTypes::Bool:
-            result = parse_bool();
-            break;
-        case TokenTypes::Number:
-            result = parse_number();
-            break;
-        case TokenTypes::String:
-            result = parse_string();
-            break;
-        case TokenTypes::Null:
-        default:
-            result = parse_null();
-            break;
-        }
+bool json_parser::Parser::pack_scalar() {
+    if (m_stack.empty() || !m_stack.back().m_array)
+        return false;
+
+    JsonArray *array = m_stack.back().m_array;
+    Token *token = current_token();
+
+    // comments before the element have to be attached to a node
+    if (!m_comments.empty() && m_comments.front()->m_pos <= token->m_pos)
+        return false;
+
+    if (token->m_type == TokenTypes::Number) {
+        if (array->size() && array->get_storage() != ArrayStorage::Numbers)
+            return false;
+        array->add_number(std::stod(token->m_value));
+        record_node(JsonTypes::JsonNumber, 0);
+    } else {
+        if (array->size() && array->get_storage() != ArrayStorage::Bools)
+            return false;
+        array->add_bool(token->m_value == "true");
+        record_node(JsonTypes::JsonBool, 0);
+    }
 
-        ret->set(key, result);
+    next_token();
+    return true;
+}
 
-        match_token(TokenTypes::Comma);
+json_parser::Object *json_parser::Parser::parse_value() {
+    // containers are attached to their parent as soon as they are opened and
+    // then tracked on m_stack until closed, so there is no recursion
+    m_stack.clear();
+    Object *root = nullptr;
+
+    try {
+        while (1) {
+            Object *node = nullptr;
+            Frame frame = { nullptr, nullptr, nullptr, npos };
+
+            if (!m_stack.empty() && !select_element(m_stack.back())) {
+                if (!close_containers())
+                    return root;
+                continue;
+            }
 
-        token = current_token();
+            switch (current_token()->m_type) {
+            case TokenTypes::OpenBrace:
+                node = frame.m_obj = open_object();
+                break;
+            case TokenTypes::OpenBracket:
+                node = frame.m_array = open_array();
+                break;
+            case TokenTypes::Bool:
+                if (!pack_scalar())
+                    node = parse_bool();
+                break;
+            case TokenTypes::Number:
+                if (!pack_scalar())
+                    node = parse_number();
+                break;
+            case TokenTypes::String:
+                node = parse_string();
+                break;
+            case TokenTypes::Null:
+            default:
+                node = parse_null();
+                break;
+            }
+
+            if (m_stack.empty())
+                root = node;
+            else if (node)
+                attach(node);
+
+            if (frame.m_obj || frame.m_array) {
+                if (m_stack.size() >= m_max_depth) {
+                    Token *token = current_token();
+                    error(
+                        "Maximum nesting depth of " + std::to_string(m_max_depth) + " exceeded",
+                        token->m_row, token->m_col);
+                }
+                // arrays pass their projection on to their elements
+                if (m_stack.empty())
+                    frame.m_projection = m_projected ? 0 : npos;
+                else if (m_stack.back().m_array)
+                    frame.m_projection = m_stack.back().m_projection;
+                else
+                    frame.m_projection = m_member_projection;
+                m_stack.push_back(frame);
+            } else if (!m_stack.empty()) {
+                match_token(TokenTypes::Comma);
+            }
+
+            if (!close_containers())
+                return root;
+        }
+    } catch (...) {
+        for (Frame &frame : m_stack)
+            delete frame.m_key;
+        delete root;
+        throw;
+    }
+}
+size_t json_parser::Parser::find_projection(size_t node, Token *key) {
+    // compare the key as written unless it has escapes to decode
+    const char *raw = m_data + key->m_pos + 1;
+    size_t len = key->m_len - 2;
+    if (key->m_escaped) {
+        m_key_scratch.clear();
+        unescape_string(raw, len, m_key_scratch);
+        raw = m_key_scratch.data();
+        len = m_key_scratch.length();
     }
 
-    match_token(TokenTypes::CloseBrace, true);
+    return m_projection.find(node, raw, len);
+}
+bool json_parser::Parser::select_member(Frame &top) {
+    m_member_projection = npos;
+    Token *key = current_token();
+    if (top.m_projection == npos || key->m_type != TokenTypes::String)
+        return true;
+
+    // a member is kept if a path ends at it, or leads through it into a
+    // container
+    size_t child = find_projection(top.m_projection, key);
+    if (child != PathTrie::NONE) {
+        if (m_projection[child].m_value != PathTrie::NONE)
+            return true;
+
+        // the value follows the key and an optional colon
+        size_t pos = m_token_pos + 1;
+        if (m_tokens[std::min(pos, m_tokens.size() - 1)]->m_type == TokenTypes::Colon)
+            pos++;
+        Token *value = m_tokens[std::min(pos, m_tokens.size() - 1)];
+        if (value->m_type == TokenTypes::OpenBrace ||
+            value->m_type == TokenTypes::OpenBracket) {
+            m_member_projection = child;
+            return true;
+        }
+    }
 
-    return ret;
+    next_token();
+    match_token(TokenTypes::Colon);
+    skip_value();
+    match_token(TokenTypes::Comma);
+    return false;
+}
+bool json_parser::Parser::select_element(Frame &top) {
+    // scalars are only kept where a path ends, never inside a projection
+    TokenTypes type = current_token()->m_type;
+    if (!top.m_array || top.m_projection == npos ||
+        type == TokenTypes::OpenBrace || type == TokenTypes::OpenBracket)
+        return true;
+
+    skip_value();
+    match_token(TokenTypes::Comma);
+    return false;
+}
+void json_parser::Parser::skip_value() {
+    m_skipper.reset();
+    bool more;
+    do {
+        more = m_skipper.step(*current_token());
+        next_token();
+    } while (more);
+
+    // comments inside the skipped value go with it
+    size_t end = current_token()->m_pos;
+    size_t count = 0;
+    while (count < m_comments.size() && m_comments[count]->m_pos < end)
+        count++;
+    m_comments.erase(m_comments.begin(), m_comments.begin() + count);
 }
+
 json_parser::JsonString *json_parser::Parser::parse_string() {
     Token *token = match_token(TokenTypes::String, true);
-    JsonString *result = new JsonString(token->m_pos, token->m_value);
+    const char *raw = m_data + token->m_pos + 1;
+    JsonString *result;
+    if (m_owned) {
+        // the copy is reused by the next document, so decode now
+        std::string val;
+        unescape_string(raw, token->m_len - 2, val);
+        result = new JsonString(token->m_pos, val);
+    } else {
+        // the span between the quotes, decoded if and when it is read
+        result = new JsonString(token->m_pos, raw, token->m_len - 2, token->m_escaped);
+    }
+    record_node(JsonTypes::JsonString, sizeof(JsonString));
+    result->m_end = token->m_pos + token->m_len;
     add_comments(result);
     return result;
 }
 json_parser::JsonBool *json_parser::Parser::parse_bool() {
     Token *boolToken = match_token(TokenTypes::Bool, true);
     JsonBool *result = new JsonBool(boolToken->m_pos, boolToken->m_value == "true");
+    record_node(JsonTypes::JsonBool, sizeof(JsonBool));
+    result->m_end = boolToken->m_pos + boolToken->m_len;
     add_comments(result);
     return result;
 }
 json_parser::JsonNull *json_parser::Parser::parse_null() {
     Token *token = match_token(TokenTypes::Null, true);
     JsonNull *result = new JsonNull(token->m_pos);
+    record_node(JsonTypes::JsonNull, sizeof(JsonNull));
+    result->m_end = token->m_pos + token->m_len;
     add_comments(result);
     return result;
 }
 json_parser::JsonNumber *json_parser::Parser::parse_number() {
     Token *numberToken = match_token(TokenTypes::Number, true);
     JsonNumber *result = new JsonNumber(numberToken->m_pos, std::stod(numberToken->m_value));
+    record_node(JsonTypes::JsonNumber, sizeof(JsonNumber));
+    result->m_end = numberToken->m_pos + numberToken->m_len;
     add_comments(result);
     return result;
 }
 
 void json_parser::Parser::add_comments(Object *ptr) {
+    StatsTimer timer(m_stats ? &m_stats->m_comments_ns : nullptr);
+
     for (size_t i = 0; i < m_comments.size(); i++) {
         if (m_comments[i]->m_pos <= ptr->m_pos) {
             Object *comment = nullptr;
             if (m_comments[i]->m_type == TokenTypes::BlockComment) {
                 comment = new JsonBlockComment(m_comments[i]->m_pos, m_comments[i]->m_value);
+                record_node(JsonTypes::JsonBlockComment,
+                    sizeof(JsonBlockComment) + string_heap_bytes(m_comments[i]->m_value));
             } else {
                 comment = new JsonLineComment(m_comments[i]->m_pos, m_comments[i]->m_value);
+                record_node(JsonTypes::JsonLineComment,
+                    sizeof(JsonLineComment) + string_heap_bytes(m_comments[i]->m_value));
             }
             ptr->add_comment(comment, true);
             m_comments.erase(m_comments.begin()+i);
@@ -211,226 +348,86 @@ void json_parser::Parser::add_comments(Object *ptr) {
     }
 }
 void json_parser::Parser::error(std::string msg, size_t line, size_t col) {
-    throw std::runtime_error(
-        "Fatal error at: line " +
-            std::to_string(line) +
-        ", col " +
-            std::to_string(col) +
-        ":\n" + msg
-    );
+    Lexer::error(msg, line, col);
 }
 
-json_parser::Token *json_parser::Parser::get_next_token() {
-    size_t start = m_pos;
-    size_t startRow = m_row;
-    size_t startCol = m_col;
-    char startChr = current_chr();
-
-    // misc: eof token
-    if (eof()) {
-        next_chr();
-        return new Token(TokenTypes::EOFToken, current_chr(), start, startRow, startCol);
-    }
-
-    // misc: whitespace token
-    if (isspace(current_chr())) {
-        while (!eof() && isspace(current_chr()))
-            next_chr();
-        size_t len = m_pos - start;
-        std::string whitespace = m_str.substr(start, m_pos - start);
-        return new Token(TokenTypes::WhiteSpace, whitespace, start, startRow, startCol);
-    }
-
-    // comments
-    if (current_chr() == '/') {
-        // comments: line comment
-        next_chr();
-        if (current_chr() == '/') {
-            next_chr();
-            while (!eof() && current_chr() != '\n' && current_chr() != '\r')
-                next_chr();
-            // dont include the // slashes
-            std::string comment = m_str.substr(start+2, m_pos-start-2);
-            return new Token(TokenTypes::LineComment, comment, start, startRow, startCol);
-        }
-        
-        // comments: block comment
-        else if (current_chr() == '*') {
-            bool hasClosingTag = false;
-
-            next_chr();
-            while (!eof()) {
-                // if there is space for closing */
-                if (m_pos+1 < m_str.length() &&
-                    m_str.substr(m_pos, 2) == "*/") {
-                    next_chr();
-                    next_chr();
-                    hasClosingTag = true;
-                    break;
-                }
-                next_chr();
-            }
-            
-            // dont include the // slashes
-            std::string comment = m_str.substr(start+2, m_pos - hasClosingTag*2 - start - 2);
-            return new Token(TokenTypes::BlockComment, comment, start, startRow, startCol);
-        }
-    }
-    
-    // objects: open & close braces and colons
-    if (current_chr() == '{') {
-        next_chr();
-        return new Token(TokenTypes::OpenBrace, startChr, start, startRow, startCol);
-    }
-    if (current_chr() == '}') {
-        next_chr();
-        return new Token(TokenTypes::CloseBrace, startChr, start, startRow, startCol);
-    }
-    if (current_chr() == ':') {
-        next_chr();
-        return new Token(TokenTypes::Colon, startChr, start, startRow, startCol);
-    }
-
-    // arrays: open & close brackets and commas
-    if (current_chr() == '[') {
-        next_chr();
-        return new Token(TokenTypes::OpenBracket, startChr, start, startRow, startCol);
+void json_parser::Parser::record_token(Token *token) {
+    if (m_stats) {
+        m_stats->m_token_counts[(size_t)token->m_type]++;
     }
-    if (current_chr() == ']') {
-        next_chr();
-        return new Token(TokenTypes::CloseBracket, startChr, start, startRow, startCol);
-    }
-    if (current_chr() == ',') {
-        next_chr();
-        return new Token(TokenTypes::Comma, startChr, start, startRow, startCol);
+}
+void json_parser::Parser::record_node(JsonTypes type, size_t bytes) {
+    if (m_stats) {
+        m_stats->m_node_counts[(size_t)type]++;
+        m_stats->m_bytes_allocated += bytes;
     }
-
-    // types: string
-    if (current_chr() == '"') {
-        bool escape = false;
-        std::string str;
-        // loop till eof
-        while (!eof()) {
-            next_chr();
-            if (escape) {
-                switch (current_chr()) {
-                case '\\': str += '\\'; break;
-                case '/': str += '/'; break;
-                case 'b': str += '\b'; break;
-                case 'f': str += '\f'; break;
-                case 'n': str += '\n'; break;
-                case 'r': str += '\r'; break;
-                case 't': str += '\t'; break;
-                case 'u':
-                    error("Unicode is not supported", m_row, m_col);
-                default:
-                    error("Unrecognised escape sequence", m_row, m_col);
-                }
-                escape = false;
-            } else if (current_chr() == '\\') {
-                str += current_chr();
-                escape = true;
-            } else if (current_chr() == '"') {
-                break;
-            } else {
-                str += current_chr();
-            }
-        }
-
-        // reached end of string
-        if (current_chr() == '"') {
-            next_chr();
-            return new Token(TokenTypes::String, str, start, startRow, startCol);
-        }
-
-        // no closing quote
-        error("No closing quote for string", m_row, m_col);
+}
+void json_parser::Parser::record_container(size_t width) {
+    if (m_stats) {
+        m_stats->m_max_depth = std::max(m_stats->m_max_depth, m_stack.size());
+        m_stats->m_max_width = std::max(m_stats->m_max_width, width);
     }
-    
-    // types: number
-    if (isdigit(current_chr()) || current_chr() == '-') {
-        // advance so that the - is not considered
-        next_chr();
-
-        // integer
-        while (!eof() && isdigit(current_chr()))
-            next_chr();
-
-        // fraction
-        if (current_chr() == '.') {
-            next_chr();
-
-            // decimal places
-            if (isdigit(current_chr())) {
-                while (!eof() && isdigit(current_chr()))
-                    next_chr();
-            } else {
-                error("A decimal point must be followed by digits", m_row, m_col);
-            }
-        }
-
-        // exponent
-        if (tolower(current_chr()) == 'e') {
-            next_chr();
-            if (current_chr() == '-'||current_chr()=='+')
-                next_chr();
-            if (isdigit(current_chr())) {
-                while (!eof() && isdigit(current_chr()))
-                    next_chr();
-            } else {
-                error("Exponent must be followed by an integer", m_row, m_col);
-            }
-        }
+}
 
-        std::string str = m_str.substr(start, m_pos - start);
-        return new Token(TokenTypes::Number, str, start, startRow, startCol);
-    }
+json_parser::Token *json_parser::Parser::get_next_token() {
+    // the slot is only claimed by reset, so discarded tokens get reused
+    if (m_pool_used == m_token_pool.size())
+        m_token_pool.push_back(new Token(TokenTypes::EOFToken, "", 0, 0, 0));
 
-    // check there is space for word
-    if (m_pos+3 < m_str.length()) {
-        if (m_pos+4 < m_str.length()) {
-            std::string str = m_str.substr(start, 5);
+    return m_lexer.next(*m_token_pool[m_pool_used]);
+}
 
-            if (str == "false") {
-                m_pos += 5;
-                m_col += 5;
-                return new Token(TokenTypes::Bool, str, m_pos, startRow, startCol);
-            }
-        }
-        
-        std::string str = m_str.substr(start, 4);
-        // types: bool (true)
-        if (str == "true") {
-            m_pos += 4;
-            m_col += 4;
-            return new Token(TokenTypes::Bool, str, m_pos, startRow, startCol);
-        }
-        // types: null
-        if (str == "null") {
-            m_pos += 4;
-            m_col += 4;
-            return new Token(TokenTypes::Null, str, m_pos, startRow, startCol);
-        }
-    }
+size_t json_parser::Parser::buffer_bytes() {
+    size_t bytes =
+        (m_token_pool.capacity() + m_tokens.capacity() + m_comments.capacity()) * sizeof(Token*) +
+        m_stack.capacity() * sizeof(Frame);
+    for (Token *token : m_token_pool)
+        bytes += sizeof(Token) + string_heap_bytes(token->m_value);
+    return bytes;
+}
 
-    // misc: EOF token
-    error(std::string("Bad Token: ") + startChr, m_row, m_col);
-    next_chr();
-    return new Token(TokenTypes::BadToken, startChr, start, startRow, startCol);
+json_parser::Parser::Parser()
+    : m_data(nullptr), m_owned(false), m_pool_used(0), m_token_pos(0),
+      m_max_depth(DEFAULT_MAX_DEPTH), m_projected(false), m_member_projection(npos), m_stats(nullptr) {
+    m_lexer.set_decode(false);
+}
+json_parser::Parser::Parser(const std::string &str, ParseStats *stats)
+    : Parser() {
+    reset(str, stats);
+}
+json_parser::Parser::~Parser() {
+    for (Token *token : m_token_pool)
+        delete token;
 }
 
-json_parser::Parser::Parser(const std::string &str) {
-    m_str = str;
-    m_pos = 0;
-    m_row = 1;
-    m_col = 1;
+void json_parser::Parser::reset(const std::string &str, ParseStats *stats) {
+    // str may be a temporary, so parse from a copy
+    m_source.assign(str);
+    reset(m_source.data(), m_source.length(), stats);
+    m_owned = true;
+}
+void json_parser::Parser::reset(const char *data, size_t len, ParseStats *stats) {
+    m_stats = stats;
+    size_t bytes = m_stats ? buffer_bytes() : 0;
+    StatsTimer timer(m_stats ? &m_stats->m_lex_ns : nullptr);
+
+    // clear and the token pool keep their capacity between documents
+    m_data = data;
+    m_owned = false;
+    m_lexer.reset(data, len);
     m_token_pos = 0;
+    m_pool_used = 0;
+    m_tokens.clear();
+    m_comments.clear();
 
     while (1) {
         Token *token = get_next_token();
+        record_token(token);
 
         if (token->m_type != TokenTypes::WhiteSpace &&
             token->m_type != TokenTypes::BadToken) {
+                m_pool_used++;
+
                 if (token->m_type == TokenTypes::BlockComment ||
                     token->m_type == TokenTypes::LineComment) {
 
@@ -443,27 +440,62 @@ json_parser::Parser::Parser(const std::string &str) {
                     break;
         }
     }
+
+    if (m_stats)
+        m_stats->m_bytes_allocated += buffer_bytes() - bytes;
 }
-json_parser::Parser::~Parser() {
-    for (Token *token : m_tokens)
-        delete token;
-    for (Token *token : m_comments)
-        delete token;
+
+void json_parser::Parser::set_max_depth(size_t depth) {
+    m_max_depth = depth;
+}
+void json_parser::Parser::set_projection(const std::vector<std::string> &paths) {
+    m_projection = PathTrie();
+    m_projected = !paths.empty();
+    for (const std::string &path : paths)
+        m_projection[m_projection.add(path)].m_value = 0;
 }
 
 json_parser::JsonObj *json_parser::Parser::parse() {
-    JsonObj *result = parse_object();
+    if (m_tokens.empty())
+        throw std::runtime_error("Parser has no document, call reset before parse");
 
-    // add any remaining comments to the last jsonObj
-    for (Token *token : m_comments) {
-        Object *comment = nullptr;
-        if (token->m_type == TokenTypes::BlockComment) {
-            comment = new JsonBlockComment(token->m_pos, token->m_value);
-        } else {
-            comment = new JsonLineComment(token->m_pos, token->m_value);
+    // the root must be an object
+    if (current_token()->m_type != TokenTypes::OpenBrace)
+        match_token(TokenTypes::OpenBrace, true);
+    return dynamic_cast<JsonObj*>(parse_any());
+}
+json_parser::Object *json_parser::Parser::parse_any() {
+    if (m_tokens.empty())
+        throw std::runtime_error("Parser has no document, call reset before parse");
+
+    uint64_t comments_ns = m_stats ? m_stats->m_comments_ns : 0;
+    Object *result = nullptr;
+
+    {
+        StatsTimer timer(m_stats ? &m_stats->m_parse_ns : nullptr);
+
+        result = parse_value();
+
+        // add any remaining comments to the root
+        StatsTimer commentsTimer(m_stats ? &m_stats->m_comments_ns : nullptr);
+        for (Token *token : m_comments) {
+            Object *comment = nullptr;
+            if (token->m_type == TokenTypes::BlockComment) {
+                comment = new JsonBlockComment(token->m_pos, token->m_value);
+                record_node(JsonTypes::JsonBlockComment,
+                    sizeof(JsonBlockComment) + string_heap_bytes(token->m_value));
+            } else {
+                comment = new JsonLineComment(token->m_pos, token->m_value);
+                record_node(JsonTypes::JsonLineComment,
+                    sizeof(JsonLineComment) + string_heap_bytes(token->m_value));
+            }
+            result->add_comment(comment, false);
         }
-        result->add_comment(comment, false);
     }
 
+    // m_parse_ns excludes the time spent attaching comments
+    if (m_stats)
+        m_stats->m_parse_ns -= m_stats->m_comments_ns - comments_ns;
+
     return result;
 }
@@ -3,61 +3,29 @@
 
 #include <string>
 #include "ast.hpp"
+#include "lexer.hpp"
+#include "scan.hpp"
 
 namespace json_parser {
 
-enum class TokenTypes {
-    // types
-    String,
-    Number,
-    Bool,
-    Null,
-
-    // objects
-    OpenBrace,    // {
-    CloseBrace,   // }
-    Colon,        // :
-
-    // arrays
-    OpenBracket,  // [
-    CloseBracket, // ]
-    Comma,        // ,
-
-    // comments
-    LineComment,  // //comment
-    BlockComment, // /* comment */
-
-    // misc
-    EOFToken,
-    WhiteSpace,
-    BadToken
-};
-
-std::string token_type_to_string(TokenTypes type);
-
-struct Token {
-    TokenTypes m_type;
-    std::string m_value;
-    size_t m_row, m_col, m_pos;
-
-    Token(TokenTypes type, char value, size_t pos, size_t row, size_t col);
-    Token(TokenTypes type, const std::string &value, size_t pos, size_t row, size_t col);
-
-    std::string to_string();
-};
+struct ParseStats;
 
 class Parser {
 private:
-    // lexer
-    std::string m_str;
-    size_t m_pos, m_row, m_col;
-
-    char current_chr();
-    char next_chr();
-    bool eof();
-
+    // lexer, strings are left escaped and decoded by the nodes on demand
+    Lexer m_lexer;
+    const char *m_data;
+    // copy of the input given as a std::string. Strings parsed from it are
+    // decoded into the nodes, so trees never point into the parser
+    std::string m_source;
+    bool m_owned;
     Token *get_next_token();
 
+    // tokens are recycled from m_token_pool, m_pool_used slots are in use
+    std::vector<Token*> m_token_pool;
+    size_t m_pool_used;
+    size_t buffer_bytes();
+
     // parser
     size_t m_token_pos;
     std::vector<Token*> m_tokens;
@@ -67,8 +35,39 @@ private:
 
     Token *match_token(TokenTypes type, bool required = false);
     
-    JsonArray *parse_array();
-    JsonObj *parse_object();
+    // containers being parsed, innermost last. m_key is the key read for
+    // the next value of an object, m_projection the projection node of the
+    // container or npos when all of it is kept
+    struct Frame {
+        JsonObj *m_obj;
+        JsonArray *m_array;
+        JsonString *m_key;
+        size_t m_projection;
+    };
+    std::vector<Frame> m_stack;
+    size_t m_max_depth;
+
+    // the projected paths, a node's value is set where a path ends. Unused
+    // unless m_projected, when the whole document is built
+    PathTrie m_projection;
+    bool m_projected;
+    // projection node for the value of the key just read
+    size_t m_member_projection;
+    std::string m_key_scratch;
+    ValueSkipper m_skipper;
+
+    size_t find_projection(size_t node, Token *key);
+    bool select_member(Frame &top);
+    bool select_element(Frame &top);
+    void skip_value();
+
+    JsonArray *open_array();
+    JsonObj *open_object();
+    void attach(Object *node);
+    // appends a number or bool to an unboxed array instead of making a node
+    bool pack_scalar();
+    bool close_containers();
+    Object *parse_value();
 
     JsonString *parse_string();
     JsonBool *parse_bool();
@@ -77,12 +76,42 @@ private:
 
     void add_comments(Object *ptr);
     void error(std::string msg, size_t line, size_t col);
+
+    // instrumentation, all no-ops when m_stats is null
+    ParseStats *m_stats;
+    void record_token(Token *token);
+    void record_node(JsonTypes type, size_t bytes);
+    void record_container(size_t width);
     
 public:
-    Parser(const std::string &str);
+    static const size_t DEFAULT_MAX_DEPTH = 512;
+
+    // an empty parser, call reset before parse
+    Parser();
+    // stats, if given, must outlive the parser. str is copied
+    Parser(const std::string &str, ParseStats *stats = nullptr);
     ~Parser();
 
+    // lexes a new document, keeping the token and scratch buffers from
+    // previous documents so steady state parsing allocates only nodes.
+    // str is copied and the tree owns its strings
+    void reset(const std::string &str, ParseStats *stats = nullptr);
+    // data is not copied: parsed strings point into it and are decoded on
+    // demand, so it must outlive both the parser and the tree
+    void reset(const char *data, size_t len, ParseStats *stats = nullptr);
+
+    // deeper input is rejected with an error rather than parsed
+    void set_max_depth(size_t depth);
+
+    // builds only the values at the given dotted paths, e.g. "user.id", and
+    // the objects leading to them. Anything else is skipped token by token
+    // without making nodes. Arrays are passed through, so "items.id" keeps
+    // the id of every element of items. An empty list builds everything
+    void set_projection(const std::vector<std::string> &paths);
+
     JsonObj *parse();
+    // as parse, but the root may be any value
+    Object *parse_any();
 };
 
 }
@@ -0,0 +1,402 @@
+#include "patch.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    using namespace json_parser;
+
+    // an array element, read without boxing packed arrays
+    struct Element {
+        JsonTypes m_type;
+        double m_number;
+        bool m_bool;
+        Object *m_node;
+    };
+    Element element(JsonArray *array, size_t idx) {
+        switch (array->get_storage()) {
+        case ArrayStorage::Numbers:
+            return { JsonTypes::JsonNumber, array->numbers()[idx], false, nullptr };
+        case ArrayStorage::Bools:
+            return { JsonTypes::JsonBool, 0, (bool)array->bools()[idx], nullptr };
+        default: {
+            Object *node = (*array)[idx];
+            return { node->get_type(), 0, false, node };
+        }
+        }
+    }
+    double number_of(const Element &elem) {
+        return elem.m_node ? dynamic_cast<JsonNumber*>(elem.m_node)->m_val : elem.m_number;
+    }
+    bool bool_of(const Element &elem) {
+        return elem.m_node ? dynamic_cast<JsonBool*>(elem.m_node)->m_val : elem.m_bool;
+    }
+    bool elements_equal(const Element &a, const Element &b, bool unordered) {
+        if (a.m_node && b.m_node)
+            return equal(a.m_node, b.m_node, unordered);
+        if (a.m_type != b.m_type)
+            return false;
+        if (a.m_type == JsonTypes::JsonNumber)
+            return number_of(a) == number_of(b);
+        return bool_of(a) == bool_of(b);
+    }
+    Object *clone_element(JsonArray *array, size_t idx) {
+        Element elem = element(array, idx);
+        if (elem.m_node)
+            return clone(elem.m_node);
+        if (elem.m_type == JsonTypes::JsonNumber)
+            return new JsonNumber(0, elem.m_number);
+        return new JsonBool(0, elem.m_bool);
+    }
+
+    bool values_equal(Object *a, Object *b, bool unordered) {
+        switch (a->get_type()) {
+        case JsonTypes::JsonString:
+            return dynamic_cast<JsonString*>(a)->equals(dynamic_cast<JsonString*>(b));
+        case JsonTypes::JsonNumber:
+            return dynamic_cast<JsonNumber*>(a)->m_val == dynamic_cast<JsonNumber*>(b)->m_val;
+        case JsonTypes::JsonBool:
+            return dynamic_cast<JsonBool*>(a)->m_val == dynamic_cast<JsonBool*>(b)->m_val;
+        case JsonTypes::JsonArray: {
+            JsonArray *arrA = dynamic_cast<JsonArray*>(a);
+            JsonArray *arrB = dynamic_cast<JsonArray*>(b);
+            if (arrA->size() != arrB->size())
+                return false;
+            for (size_t i = 0; i < arrA->size(); i++) {
+                if (!elements_equal(element(arrA, i), element(arrB, i), unordered))
+                    return false;
+            }
+            return true;
+        }
+        case JsonTypes::JsonObj: {
+            JsonObj *objA = dynamic_cast<JsonObj*>(a);
+            JsonObj *objB = dynamic_cast<JsonObj*>(b);
+            if (objA->size() != objB->size())
+                return false;
+            for (size_t i = 0; i < objA->size(); i++) {
+                JsonString *key = objA->key_at(i);
+                Object *other = nullptr;
+
+                // same position first, the usual case even when unordered
+                if (key->equals(objB->key_at(i)))
+                    other = objB->value_at(i);
+                else if (unordered)
+                    other = objB->get(key->get_value());
+
+                if (!other || !equal(objA->value_at(i), other, unordered))
+                    return false;
+            }
+            return true;
+        }
+        default:
+            return true;
+        }
+    }
+
+    /* Diff */
+    std::string escape_pointer(const std::string &token) {
+        std::string result;
+        for (char chr : token) {
+            if (chr == '~')
+                result += "~0";
+            else if (chr == '/')
+                result += "~1";
+            else
+                result += chr;
+        }
+        return result;
+    }
+
+    void add_op(JsonArray *patch, const std::string &op, const std::string &path, Object *value) {
+        JsonObj *result = new JsonObj(0);
+        result->set(new JsonString(0, "op"), new JsonString(0, op));
+        result->set(new JsonString(0, "path"), new JsonString(0, path));
+        if (value)
+            result->set(new JsonString(0, "value"), value);
+        patch->add_child(result);
+    }
+
+    void diff_value(Object *from, Object *to, const std::string &path, JsonArray *patch);
+
+    void diff_object(JsonObj *from, JsonObj *to, const std::string &path, JsonArray *patch) {
+        for (size_t i = 0; i < from->size(); i++) {
+            const std::string &key = from->key_at(i)->get_value();
+            Object *other = to->get(key);
+            if (!other)
+                add_op(patch, "remove", path + '/' + escape_pointer(key), nullptr);
+            else
+                diff_value(from->value_at(i), other, path + '/' + escape_pointer(key), patch);
+        }
+        for (size_t i = 0; i < to->size(); i++) {
+            const std::string &key = to->key_at(i)->get_value();
+            if (!from->get(key))
+                add_op(patch, "add", path + '/' + escape_pointer(key), clone(to->value_at(i)));
+        }
+    }
+    void diff_array(JsonArray *from, JsonArray *to, const std::string &path, JsonArray *patch) {
+        size_t fromSize = from->size(), toSize = to->size();
+
+        // unchanged ends need no operations
+        size_t start = 0;
+        while (start < fromSize && start < toSize &&
+               elements_equal(element(from, start), element(to, start), true))
+            start++;
+        size_t fromEnd = fromSize, toEnd = toSize;
+        while (fromEnd > start && toEnd > start &&
+               elements_equal(element(from, fromEnd - 1), element(to, toEnd - 1), true)) {
+            fromEnd--;
+            toEnd--;
+        }
+
+        // elements in the middle are matched by position
+        size_t common = std::min(fromEnd - start, toEnd - start);
+        for (size_t i = start; i < start + common; i++) {
+            std::string elemPath = path + '/' + std::to_string(i);
+            Element a = element(from, i), b = element(to, i);
+            if (a.m_node && b.m_node)
+                diff_value(a.m_node, b.m_node, elemPath, patch);
+            else if (!elements_equal(a, b, true))
+                add_op(patch, "replace", elemPath, clone_element(to, i));
+        }
+
+        // removing at the same index shifts the next element into place
+        for (size_t i = start + common; i < fromEnd; i++)
+            add_op(patch, "remove", path + '/' + std::to_string(start + common), nullptr);
+        for (size_t i = start + common; i < toEnd; i++)
+            add_op(patch, "add", path + '/' + std::to_string(i), clone_element(to, i));
+    }
+    void diff_value(Object *from, Object *to, const std::string &path, JsonArray *patch) {
+        if (equal(from, to, true))
+            return;
+
+        JsonTypes type = from->get_type();
+        if (type != to->get_type() ||
+            (type != JsonTypes::JsonObj && type != JsonTypes::JsonArray)) {
+            add_op(patch, "replace", path, clone(to));
+        } else if (type == JsonTypes::JsonObj) {
+            diff_object(dynamic_cast<JsonObj*>(from), dynamic_cast<JsonObj*>(to), path, patch);
+        } else {
+            diff_array(dynamic_cast<JsonArray*>(from), dynamic_cast<JsonArray*>(to), path, patch);
+        }
+    }
+
+    /* Patching */
+    void patch_error(const std::string &msg) {
+        throw std::runtime_error("Invalid JSON Patch: " + msg);
+    }
+
+    std::vector<std::string> parse_pointer(const std::string &pointer) {
+        std::vector<std::string> tokens;
+        if (pointer.empty())
+            return tokens;
+        if (pointer[0] != '/')
+            patch_error("path must start with '/': " + pointer);
+
+        for (size_t i = 0; i < pointer.length(); i++) {
+            char chr = pointer[i];
+            if (chr == '/') {
+                tokens.emplace_back();
+            } else if (chr == '~') {
+                char next = i + 1 < pointer.length() ? pointer[++i] : '\0';
+                if (next != '0' && next != '1')
+                    patch_error("bad escape in path: " + pointer);
+                tokens.back() += next == '0' ? '~' : '/';
+            } else {
+                tokens.back() += chr;
+            }
+        }
+        return tokens;
+    }
+    // index into an array, size allowed for "-" or an append
+    size_t parse_index(const std::string &token, size_t size, bool append) {
+        if (append && token == "-")
+            return size;
+        if (token.empty() || token.length() > 18 ||
+            (token.length() > 1 && token[0] == '0') ||
+            token.find_first_not_of("0123456789") != std::string::npos)
+            patch_error("bad array index: " + token);
+
+        size_t idx = std::stoull(token);
+        if (idx > size || (idx == size && !append))
+            patch_error("array index out of range: " + token);
+        return idx;
+    }
+
+    // the value reached by the first count tokens of a path
+    Object *resolve(Object *root, const std::vector<std::string> &tokens, size_t count) {
+        Object *node = root;
+        for (size_t i = 0; i < count; i++) {
+            const std::string &token = tokens[i];
+
+            Object *next = nullptr;
+            if (JsonObj *object = dynamic_cast<JsonObj*>(node)) {
+                next = object->get(token);
+            } else if (JsonArray *array = dynamic_cast<JsonArray*>(node)) {
+                next = (*array)[parse_index(token, array->size(), false)];
+            }
+            if (!next)
+                patch_error("no such path: /" + token);
+            node = next;
+        }
+        return node;
+    }
+
+    std::string member_string(JsonObj *op, const std::string &key) {
+        JsonString *str = dynamic_cast<JsonString*>(op->get(key));
+        if (!str)
+            patch_error("operation is missing \"" + key + "\"");
+        return str->get_value();
+    }
+    Object *member_value(JsonObj *op) {
+        Object *value = op->get("value");
+        if (!value)
+            patch_error("operation is missing \"value\"");
+        return value;
+    }
+
+    // detaches the value at a path and hands it to the caller
+    Object *take(Object *&root, const std::vector<std::string> &tokens) {
+        if (tokens.empty()) {
+            Object *result = root;
+            root = nullptr;
+            return result;
+        }
+
+        Object *parent = resolve(root, tokens, tokens.size() - 1);
+        const std::string &last = tokens.back();
+
+        Object *result = nullptr;
+        if (JsonObj *object = dynamic_cast<JsonObj*>(parent)) {
+            result = object->remove(last);
+        } else if (JsonArray *array = dynamic_cast<JsonArray*>(parent)) {
+            result = array->remove_child(parse_index(last, array->size(), false));
+        }
+        if (!result)
+            patch_error("no such path: /" + last);
+        return result;
+    }
+    // places value at a path, replacing what is there for objects and the
+    // root. Array elements are inserted unless replace is set
+    void put(Object *&root, const std::vector<std::string> &tokens, Object *value, bool replace = false) {
+        if (tokens.empty()) {
+            delete root;
+            root = value;
+            return;
+        }
+
+        try {
+            Object *parent = resolve(root, tokens, tokens.size() - 1);
+            const std::string &last = tokens.back();
+
+            if (JsonObj *object = dynamic_cast<JsonObj*>(parent)) {
+                object->set(new JsonString(0, last), value);
+            } else if (JsonArray *array = dynamic_cast<JsonArray*>(parent)) {
+                if (replace)
+                    delete array->replace_child(parse_index(last, array->size(), false), value);
+                else
+                    array->insert_child(parse_index(last, array->size(), true), value);
+            } else {
+                patch_error("cannot add to a " + obj_type_to_string(parent->get_type()));
+            }
+        } catch (...) {
+            delete value;
+            throw;
+        }
+    }
+}
+
+/* Comparison */
+json_parser::Object *json_parser::clone(Object *obj) {
+    switch (obj->get_type()) {
+    case JsonTypes::JsonString:
+        return new JsonString(obj->m_pos, dynamic_cast<JsonString*>(obj)->get_value());
+    case JsonTypes::JsonNumber:
+        return new JsonNumber(obj->m_pos, dynamic_cast<JsonNumber*>(obj)->m_val);
+    case JsonTypes::JsonBool:
+        return new JsonBool(obj->m_pos, dynamic_cast<JsonBool*>(obj)->m_val);
+    case JsonTypes::JsonArray: {
+        JsonArray *array = dynamic_cast<JsonArray*>(obj);
+        JsonArray *result = new JsonArray(obj->m_pos);
+        if (array->get_storage() == ArrayStorage::Numbers) {
+            for (double val : array->numbers())
+                result->add_number(val);
+        } else if (array->get_storage() == ArrayStorage::Bools) {
+            for (uint8_t val : array->bools())
+                result->add_bool(val);
+        } else {
+            for (size_t i = 0; i < array->size(); i++)
+                result->add_child(clone((*array)[i]));
+        }
+        return result;
+    }
+    case JsonTypes::JsonObj: {
+        JsonObj *object = dynamic_cast<JsonObj*>(obj);
+        JsonObj *result = new JsonObj(obj->m_pos);
+        for (size_t i = 0; i < object->size(); i++) {
+            result->set(
+                new JsonString(object->key_at(i)->m_pos, object->key_at(i)->get_value()),
+                clone(object->value_at(i)));
+        }
+        return result;
+    }
+    default:
+        return new JsonNull(obj->m_pos);
+    }
+}
+
+bool json_parser::equal(Object *a, Object *b, bool unordered) {
+    if (a == b)
+        return true;
+    if (a->get_type() != b->get_type() || a->hash(unordered) != b->hash(unordered))
+        return false;
+    // equal hashes are confirmed, a collision must not hide a difference
+    return values_equal(a, b, unordered);
+}
+
+/* Patching */
+json_parser::JsonArray *json_parser::diff(Object *from, Object *to) {
+    JsonArray *patch = new JsonArray(0);
+    diff_value(from, to, "", patch);
+    return patch;
+}
+
+void json_parser::apply_patch(Object *&root, JsonArray *patch) {
+    for (size_t i = 0; i < patch->size(); i++) {
+        JsonObj *op = dynamic_cast<JsonObj*>((*patch)[i]);
+        if (!op)
+            patch_error("operation " + std::to_string(i) + " is not an object");
+
+        std::string name = member_string(op, "op");
+        std::vector<std::string> path = parse_pointer(member_string(op, "path"));
+
+        if (name == "add") {
+            put(root, path, clone(member_value(op)));
+        } else if (name == "remove") {
+            if (path.empty())
+                patch_error("cannot remove the root");
+            delete take(root, path);
+        } else if (name == "replace") {
+            // the target must exist, unlike add, and the value takes its place
+            resolve(root, path, path.size());
+            put(root, path, clone(member_value(op)), true);
+        } else if (name == "move") {
+            std::string from = member_string(op, "from");
+            std::string to = member_string(op, "path");
+            if (to.compare(0, from.length() + 1, from + '/') == 0)
+                patch_error("cannot move a value into itself: " + from);
+            Object *value = take(root, parse_pointer(from));
+            put(root, path, value);
+        } else if (name == "copy") {
+            std::vector<std::string> from = parse_pointer(member_string(op, "from"));
+            Object *value = resolve(root, from, from.size());
+            put(root, path, clone(value));
+        } else if (name == "test") {
+            if (!equal(resolve(root, path, path.size()), member_value(op), true))
+                patch_error("test failed at " + member_string(op, "path"));
+        } else {
+            patch_error("unknown operation: " + name);
+        }
+    }
+}
@@ -0,0 +1,352 @@
+#include "preserve.hpp"
+#include "lexer.hpp"
+
+namespace {
+    using namespace json_parser;
+
+    const size_t npos = std::string::npos;
+
+    // a member of a container, the key is nullptr for arrays. start is the
+    // key for object members, so [start, end) covers the whole member
+    struct Member {
+        JsonString *m_key;
+        Object *m_val;
+        bool m_placed;
+        size_t m_start, m_end;
+    };
+
+    class PreservingWriter {
+    private:
+        const std::string &m_source;
+        std::string &m_out;
+        // input before m_cursor has been written or replaced
+        size_t m_cursor;
+
+        bool has_place(Object *obj) {
+            return obj->m_end != npos && obj->m_pos < obj->m_end && obj->m_end <= m_source.length();
+        }
+        bool is_container(Object *obj) {
+            return obj->get_type() == JsonTypes::JsonObj || obj->get_type() == JsonTypes::JsonArray;
+        }
+        // whether the text at obj's place is a container of its type. A
+        // value standing where another was parsed may not be
+        bool own_brackets(Object *obj) {
+            bool isObj = obj->get_type() == JsonTypes::JsonObj;
+            return m_source[obj->m_pos] == (isObj ? '{' : '[') &&
+                m_source[obj->m_end - 1] == (isObj ? '}' : ']');
+        }
+        void copy_to(size_t pos) {
+            // unchanged input is gathered up and copied in one go
+            if (pos > m_cursor) {
+                m_out.append(m_source, m_cursor, pos - m_cursor);
+                m_cursor = pos;
+            }
+        }
+
+        // the members of a container in order, false for packed arrays
+        bool members(Object *obj, std::vector<Member> &result) {
+            if (JsonObj *object = dynamic_cast<JsonObj*>(obj)) {
+                for (size_t i = 0; i < object->size(); i++) {
+                    JsonString *key = object->key_at(i);
+                    Object *val = object->value_at(i);
+                    bool placed = has_place(key) && has_place(val);
+                    result.push_back({ key, val, placed, key->m_pos, val->m_end });
+                }
+                return true;
+            }
+
+            JsonArray *array = dynamic_cast<JsonArray*>(obj);
+            if (array->get_storage() != ArrayStorage::Boxed)
+                return false;
+            for (size_t i = 0; i < array->size(); i++) {
+                Object *val = (*array)[i];
+                result.push_back({ nullptr, val, has_place(val), val->m_pos, val->m_end });
+            }
+            return true;
+        }
+        // whether the placed members lie in order within the container, so
+        // the text between them can be reused
+        bool in_order(Object *obj, const std::vector<Member> &list) {
+            size_t prev = obj->m_pos + 1;
+            for (const Member &member : list) {
+                if (!member.m_placed)
+                    continue;
+                if (member.m_start < prev || member.m_end >= obj->m_end ||
+                    (member.m_key && member.m_key->m_end > member.m_val->m_pos))
+                    return false;
+                prev = member.m_end;
+            }
+            return true;
+        }
+        // whether a clean container can be written by patching changes into
+        // its text: every changed member has a place and they are in order
+        bool patchable(Object *obj) {
+            std::vector<Member> list;
+            if (!members(obj, list))
+                return true;
+            for (const Member &member : list) {
+                // elements boxed from a packed array have no place of their
+                // own but are covered by the array's text
+                if (!member.m_placed && member.m_val->m_dirty)
+                    return false;
+            }
+            return in_order(obj, list);
+        }
+
+        // the first ',' or closing bracket from pos, past whitespace and
+        // comments
+        size_t next_separator(size_t pos) {
+            while (pos < m_source.length()) {
+                char chr = m_source[pos];
+                if (isspace((unsigned char)chr)) {
+                    pos++;
+                } else if (m_source.compare(pos, 2, "//") == 0) {
+                    pos = m_source.find_first_of("\r\n", pos);
+                } else if (m_source.compare(pos, 2, "/*") == 0) {
+                    pos = m_source.find("*/", pos + 2);
+                    pos = pos == npos ? npos : pos + 2;
+                } else {
+                    break;
+                }
+            }
+            return std::min(pos, m_source.length());
+        }
+        // the end of pos's line when only whitespace and comments follow pos
+        // on it, otherwise pos
+        size_t line_end(size_t pos) {
+            size_t end = pos;
+            while (end < m_source.length()) {
+                char chr = m_source[end];
+                if (chr == '\n' || chr == '\r') {
+                    return end;
+                } else if (chr == ' ' || chr == '\t') {
+                    end++;
+                } else if (m_source.compare(end, 2, "//") == 0) {
+                    end = m_source.find_first_of("\r\n", end);
+                } else if (m_source.compare(end, 2, "/*") == 0) {
+                    end = m_source.find("*/", end + 2);
+                    if (end == npos || m_source.find('\n', pos) < end)
+                        return pos;
+                    end += 2;
+                } else {
+                    return pos;
+                }
+            }
+            return pos;
+        }
+        // just past the last top level ',' in [from, to), or from if there
+        // is none. Only removed members are lexed here, and a comment after
+        // the comma on the same line goes with them
+        size_t after_last_comma(size_t from, size_t to) {
+            Lexer lexer(m_source.data() + from, to - from);
+            lexer.set_decode(false);
+            Token token(TokenTypes::EOFToken, "", 0, 0, 0);
+
+            size_t result = from, depth = 0;
+            while (lexer.next(token)->m_type != TokenTypes::EOFToken) {
+                switch (token.m_type) {
+                case TokenTypes::OpenBrace:
+                case TokenTypes::OpenBracket:
+                    depth++;
+                    break;
+                case TokenTypes::CloseBrace:
+                case TokenTypes::CloseBracket:
+                    depth--;
+                    break;
+                case TokenTypes::Comma:
+                    if (!depth)
+                        result = from + token.m_pos + 1;
+                    break;
+                default:
+                    break;
+                }
+            }
+            return result == from ? from : line_end(result);
+        }
+
+        // the line's leading whitespace, the indent nodes there are drawn with
+        std::string indent_at(size_t pos) {
+            size_t start = m_source.rfind('\n', pos);
+            start = start == npos ? 0 : start + 1;
+            size_t end = start;
+            while (end < pos && (m_source[end] == ' ' || m_source[end] == '\t'))
+                end++;
+            return m_source.substr(start, end - start);
+        }
+
+        std::string render_value(Object *obj, const std::string &indent) {
+            std::string result;
+            for (Object *comment : obj->m_comment_before)
+                result += comment->to_string("") + indent;
+            result += render(obj, indent);
+            for (Object *comment : obj->m_comment_after)
+                result += indent + comment->to_string("");
+            return result;
+        }
+        // obj as to_string writes it, except that members that are unchanged
+        // are copied from the input
+        std::string render(Object *obj, const std::string &indent) {
+            // containers out of order would come straight back here
+            if (has_place(obj) && !obj->m_dirty && (!is_container(obj) || patchable(obj))) {
+                std::string result;
+                PreservingWriter(m_source, result, obj->m_pos).write(obj);
+                return result;
+            }
+
+            std::vector<Member> list;
+            if (!is_container(obj) || !members(obj, list) || list.empty())
+                return obj->to_string(indent);
+
+            bool isObj = list[0].m_key;
+            std::string inner = indent + "    ";
+            std::string result = isObj ? "{\n" : "[\n";
+            for (size_t i = 0; i < list.size(); i++) {
+                result += inner;
+                if (isObj)
+                    result += list[i].m_key->to_string_comments(inner) + ": ";
+                result += render_value(list[i].m_val, inner);
+                if (i + 1 < list.size())
+                    result += ',';
+                result += '\n';
+            }
+            result += indent + (isObj ? '}' : ']');
+            return result;
+        }
+
+        // a container that gained or lost members, in place of its text.
+        // Members still in the input are copied with the whitespace and
+        // comments before them, new members are laid out like their siblings
+        void rewrite_container(Object *obj) {
+            std::vector<Member> list;
+            if (!has_place(obj) || !own_brackets(obj) || !members(obj, list) || !in_order(obj, list)) {
+                m_out += obj->to_string(indent_at(obj->m_pos));
+                return;
+            }
+
+            std::string indent = indent_at(obj->m_pos);
+            std::string inner = indent + "    ";
+            for (const Member &member : list) {
+                if (member.m_placed) {
+                    inner = indent_at(member.m_start);
+                    break;
+                }
+            }
+
+            // containers written on one line get new members on that line
+            bool oneLine = m_source.find('\n', obj->m_pos) >= obj->m_end;
+            std::string lead = oneLine ? " " : '\n' + inner;
+            std::string close = oneLine ? "" : '\n' + indent;
+
+            m_out += m_source[obj->m_pos];
+            size_t region = obj->m_pos + 1;
+            // where the input's text after its last member starts, when that
+            // member was the last one written
+            size_t tail = npos;
+
+            for (size_t i = 0; i < list.size(); i++) {
+                const Member &member = list[i];
+                bool more = i + 1 < list.size();
+
+                if (!member.m_placed) {
+                    m_out += lead;
+                    if (member.m_key)
+                        m_out += member.m_key->to_string_comments(inner) + ": ";
+                    m_out += render_value(member.m_val, inner);
+                    if (more)
+                        m_out += ',';
+                    tail = npos;
+                    continue;
+                }
+
+                // any members between the last one written and this one
+                // were removed, so start after the last comma among them
+                PreservingWriter writer(m_source, m_out, after_last_comma(region, member.m_start));
+                if (member.m_key)
+                    writer.visit(member.m_key);
+                writer.visit(member.m_val);
+                writer.copy_to(member.m_end);
+
+                size_t separator = next_separator(member.m_end);
+                if (separator < obj->m_end - 1 && m_source[separator] == ',') {
+                    // a comment on the rest of the line after the comma
+                    // belongs to this member, whatever follows was removed
+                    region = line_end(separator + 1);
+                    tail = npos;
+                    if (more) {
+                        m_out.append(m_source, member.m_end, region - member.m_end);
+                    } else {
+                        // members after it were removed, drop the comma
+                        m_out.append(m_source, member.m_end, separator - member.m_end);
+                        m_out.append(m_source, separator + 1, region - separator - 1);
+                    }
+                    continue;
+                }
+
+                // the input's last member. A comment on the rest of its line
+                // stays with it when members follow
+                region = separator;
+                tail = member.m_end;
+                if (more) {
+                    size_t line = m_source.find('\n', member.m_end);
+                    line = line < separator ? line : member.m_end;
+                    m_out += ',';
+                    m_out.append(m_source, member.m_end, line - member.m_end);
+                    tail = line == member.m_end ? npos : line;
+                }
+            }
+
+            if (tail != npos)
+                m_out.append(m_source, tail, obj->m_end - tail);
+            else if (list.empty())
+                m_out += m_source[obj->m_end - 1];
+            else
+                m_out += close + m_source[obj->m_end - 1];
+        }
+
+        void visit(Object *obj) {
+            bool container = is_container(obj);
+            if (obj->m_dirty || (container && !patchable(obj))) {
+                copy_to(obj->m_pos);
+                if (container)
+                    rewrite_container(obj);
+                else
+                    m_out += obj->to_string(indent_at(obj->m_pos));
+                m_cursor = obj->m_end;
+                return;
+            }
+
+            std::vector<Member> list;
+            if (!container || !members(obj, list))
+                return;
+            for (const Member &member : list) {
+                if (member.m_key && has_place(member.m_key))
+                    visit(member.m_key);
+                if (has_place(member.m_val))
+                    visit(member.m_val);
+            }
+        }
+
+    public:
+        PreservingWriter(const std::string &source, std::string &out, size_t cursor)
+            : m_source(source), m_out(out), m_cursor(cursor) {}
+
+        // writes the input from the cursor to the end of obj
+        void write(Object *obj) {
+            visit(obj);
+            copy_to(obj->m_end);
+        }
+    };
+}
+
+/* Preserving */
+std::string json_parser::write_preserved(Object *root, const std::string &source) {
+    std::string result;
+    if (root->m_end == npos || root->m_end > source.length())
+        return root->to_string_comments("");
+
+    // text around the root, such as leading comments, is kept too
+    PreservingWriter writer(source, result, 0);
+    writer.write(root);
+    result.append(source, root->m_end, npos);
+    return result;
+}
@@ -0,0 +1,84 @@
+#include "scan.hpp"
+
+#include <cstring>
+
+/* PathTrie */
+const size_t json_parser::PathTrie::NONE;
+
+json_parser::PathTrie::PathTrie() {
+    m_nodes.push_back({ {}, NONE });
+}
+
+size_t json_parser::PathTrie::add(const std::string &path) {
+    size_t node = 0, start = 0;
+    while (1) {
+        size_t dot = path.find('.', start);
+        std::string key = path.substr(start, dot == std::string::npos ? dot : dot - start);
+
+        size_t child = find(node, key);
+        if (child == NONE) {
+            child = m_nodes.size();
+            m_nodes.push_back({ {}, NONE });
+            m_nodes[node].m_children.emplace_back(key, child);
+        }
+        node = child;
+
+        if (dot == std::string::npos)
+            return node;
+        start = dot + 1;
+    }
+}
+size_t json_parser::PathTrie::find(size_t node, const char *key, size_t len) const {
+    for (const auto &child : m_nodes[node].m_children) {
+        if (child.first.length() == len && memcmp(child.first.data(), key, len) == 0)
+            return child.second;
+    }
+    return NONE;
+}
+size_t json_parser::PathTrie::find(size_t node, const std::string &key) const {
+    return find(node, key.data(), key.length());
+}
+
+json_parser::PathTrie::Node &json_parser::PathTrie::operator[](size_t node) {
+    return m_nodes[node];
+}
+const json_parser::PathTrie::Node &json_parser::PathTrie::operator[](size_t node) const {
+    return m_nodes[node];
+}
+size_t json_parser::PathTrie::size() const {
+    return m_nodes.size();
+}
+
+/* ValueSkipper */
+void json_parser::ValueSkipper::reset() {
+    m_closers.clear();
+}
+bool json_parser::ValueSkipper::step(const Token &token) {
+    switch (token.m_type) {
+    case TokenTypes::OpenBrace:
+        m_closers.push_back(TokenTypes::CloseBrace);
+        break;
+    case TokenTypes::OpenBracket:
+        m_closers.push_back(TokenTypes::CloseBracket);
+        break;
+    case TokenTypes::CloseBrace:
+    case TokenTypes::CloseBracket:
+        if (m_closers.empty())
+            Lexer::error("Expected a value", token.m_row, token.m_col);
+        if (m_closers.back() != token.m_type) {
+            Lexer::error(
+                "Expected token: " +
+                    token_type_to_string(m_closers.back()) +
+                "\nActual token: " +
+                    token_type_to_string(token.m_type),
+                token.m_row, token.m_col);
+        }
+        m_closers.pop_back();
+        break;
+    case TokenTypes::EOFToken:
+        Lexer::error("Unexpected end of input", token.m_row, token.m_col);
+    default:
+        break;
+    }
+    return !m_closers.empty();
+}
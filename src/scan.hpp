@@ -0,0 +1,56 @@
+#if !defined(JSONPARSER_SCAN_HPP)
+#define JSONPARSER_SCAN_HPP
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "lexer.hpp"
+
+namespace json_parser {
+
+// Trie of dotted paths such as "user.id", for selecting fields while
+// scanning tokens. Node 0 is the root.
+class PathTrie {
+public:
+    static const size_t NONE = (size_t)-1;
+
+    struct Node {
+        std::vector<std::pair<std::string, size_t>> m_children;
+        // set by the owner for nodes where a path ends, NONE elsewhere
+        size_t m_value;
+    };
+
+    PathTrie();
+
+    // adds the nodes of path, returns the one it ends at
+    size_t add(const std::string &path);
+    // child of node for key, or NONE
+    size_t find(size_t node, const char *key, size_t len) const;
+    size_t find(size_t node, const std::string &key) const;
+
+    Node &operator[](size_t node);
+    const Node &operator[](size_t node) const;
+    size_t size() const;
+
+private:
+    std::vector<Node> m_nodes;
+};
+
+// Skips the tokens of one value without making nodes, checking that the
+// brackets inside it match. Feed it tokens from the first of the value
+// until step returns false.
+class ValueSkipper {
+public:
+    void reset();
+    // whether the value continues after token
+    bool step(const Token &token);
+
+private:
+    // closing token expected for each open container
+    std::vector<TokenTypes> m_closers;
+};
+
+}
+
+#endif // JSONPARSER_SCAN_HPP
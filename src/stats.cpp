@@ -0,0 +1,35 @@
+#include "stats.hpp"
+
+/* ParseStats */
+void json_parser::ParseStats::reset() {
+    *this = ParseStats();
+}
+
+size_t json_parser::ParseStats::token_count(TokenTypes type) const {
+    return m_token_counts[(size_t)type];
+}
+size_t json_parser::ParseStats::node_count(JsonTypes type) const {
+    return m_node_counts[(size_t)type];
+}
+
+std::string json_parser::ParseStats::to_string() const {
+    std::string result =
+        "lex_ns: " + std::to_string(m_lex_ns) +
+        "\nparse_ns: " + std::to_string(m_parse_ns) +
+        "\ncomments_ns: " + std::to_string(m_comments_ns) +
+        "\nserialize_ns: " + std::to_string(m_serialize_ns) +
+        "\nbytes_allocated: " + std::to_string(m_bytes_allocated) +
+        "\nmax_depth: " + std::to_string(m_max_depth) +
+        "\nmax_width: " + std::to_string(m_max_width);
+
+    for (size_t i = 0; i <= (size_t)TokenTypes::BadToken; i++) {
+        result += "\ntokens[" + token_type_to_string((TokenTypes)i) + "]: " +
+            std::to_string(m_token_counts[i]);
+    }
+    for (size_t i = 0; i <= (size_t)JsonTypes::JsonBlockComment; i++) {
+        result += "\nnodes[" + obj_type_to_string((JsonTypes)i) + "]: " +
+            std::to_string(m_node_counts[i]);
+    }
+
+    return result;
+}
@@ -0,0 +1,110 @@
+#include "utf8.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Scanning */
+size_t json_parser::string_run_length(const char *data, size_t len) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i carriage = _mm_set1_epi8('\r');
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i special = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, newline), _mm_cmpeq_epi8(chunk, carriage)));
+
+        // the high bit of chunk itself flags non-ascii bytes
+        if (_mm_movemask_epi8(_mm_or_si128(special, chunk)))
+            break;
+    }
+#endif
+
+    // tail, or the block containing the first special byte
+    for (; i < len; i++) {
+        unsigned char c = data[i];
+        if (c >= 0x80 || c == '"' || c == '\\' || c == '\n' || c == '\r')
+            break;
+    }
+    return i;
+}
+
+size_t json_parser::utf8_sequence_length(const char *data, size_t len) {
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(data);
+    if (!len)
+        return 0;
+
+    unsigned char c = bytes[0];
+    if (c < 0x80)
+        return 1;
+
+    // valid range of the second byte, which rules out overlong encodings,
+    // surrogates and code points above U+10FFFF
+    size_t length;
+    unsigned char lo = 0x80, hi = 0xBF;
+    if (c >= 0xC2 && c <= 0xDF) {
+        length = 2;
+    } else if (c >= 0xE0 && c <= 0xEF) {
+        length = 3;
+        if (c == 0xE0) lo = 0xA0;
+        if (c == 0xED) hi = 0x9F;
+    } else if (c >= 0xF0 && c <= 0xF4) {
+        length = 4;
+        if (c == 0xF0) lo = 0x90;
+        if (c == 0xF4) hi = 0x8F;
+    } else {
+        return 0;
+    }
+
+    if (len < length || bytes[1] < lo || bytes[1] > hi)
+        return 0;
+    for (size_t i = 2; i < length; i++) {
+        if ((bytes[i] & 0xC0) != 0x80)
+            return 0;
+    }
+    return length;
+}
+
+size_t json_parser::validate_utf8(const char *data, size_t len) {
+    size_t i = 0;
+    while (i < len) {
+#if defined(__SSE2__)
+        // skip whole blocks of ascii
+        while (i + 16 <= len &&
+               !_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i))))
+            i += 16;
+        if (i == len)
+            break;
+#endif
+        size_t length = utf8_sequence_length(data + i, len - i);
+        if (!length)
+            return i;
+        i += length;
+    }
+    return len;
+}
+
+/* Encoding */
+void json_parser::append_utf8(std::string &str, uint32_t code_point) {
+    if (code_point < 0x80) {
+        str += (char)code_point;
+    } else if (code_point < 0x800) {
+        str += (char)(0xC0 | (code_point >> 6));
+        str += (char)(0x80 | (code_point & 0x3F));
+    } else if (code_point < 0x10000) {
+        str += (char)(0xE0 | (code_point >> 12));
+        str += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        str += (char)(0x80 | (code_point & 0x3F));
+    } else {
+        str += (char)(0xF0 | (code_point >> 18));
+        str += (char)(0x80 | ((code_point >> 12) & 0x3F));
+        str += (char)(0x80 | ((code_point >> 6) & 0x3F));
+        str += (char)(0x80 | (code_point & 0x3F));
+    }
+}
@@ -0,0 +1,25 @@
+#if !defined(JSONPARSER_UTF8_HPP)
+#define JSONPARSER_UTF8_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace json_parser {
+
+// number of leading bytes that are plain ascii and can be copied into a
+// string token as is, i.e. stops at '"', '\\', '\n', '\r' and non-ascii
+size_t string_run_length(const char *data, size_t len);
+
+// length of the UTF-8 sequence starting at data, 0 if it is not valid
+size_t utf8_sequence_length(const char *data, size_t len);
+
+// offset of the first byte that is not valid UTF-8, len if all are valid
+size_t validate_utf8(const char *data, size_t len);
+
+// appends the UTF-8 encoding of a code point (at most U+10FFFF)
+void append_utf8(std::string &str, uint32_t code_point);
+
+}
+
+#endif // JSONPARSER_UTF8_HPP